@@ -0,0 +1,117 @@
+/*
+		DebugLog.h
+		Compile time log levels, one per module:
+			LOG_LEVEL_DRIVE		... HolonomicDrive.h
+			LOG_LEVEL_MAIN		... Sentinal.c
+			LOG_LEVEL_LCD			... LCDManager.h
+		Each module logs through its own macros, one per level:
+			XXX_ERROR(...)		... something is broken
+			XXX_INFO(...)			... once per run or per mode
+			XXX_DEBUG(...)		... every call, in the loops
+			XXX_EVENT(id, a, b, c) ... a binary record at DEBUG level,
+														see EventLog.h
+		A macro above its module's level expands to nothing, so the
+		statement and the evaluation of its arguments are gone from
+		the program, not skipped at run time.
+
+		Define SENTINAL_RELEASE for a build with errors only. Any
+		level can also be set by defining it before this file is
+		included.
+
+		Define SENTINAL_BENCHMARK to have the drive test time a
+		moveDistance loop cycle first (driveLogBenchmark,
+		HolonomicDrive.h), once in each build to compare, and a
+		mission time the interpreter first (missionBenchmark,
+		MissionRunner.h).
+*/
+
+#define LOG_LEVEL_OFF 		0
+#define LOG_LEVEL_ERROR 	1
+#define LOG_LEVEL_INFO 		2
+#define LOG_LEVEL_DEBUG 	3
+
+//#define SENTINAL_RELEASE
+//#define SENTINAL_BENCHMARK
+
+#ifdef SENTINAL_RELEASE
+	#ifndef LOG_LEVEL_DRIVE
+		#define LOG_LEVEL_DRIVE 	LOG_LEVEL_ERROR
+	#endif
+	#ifndef LOG_LEVEL_MAIN
+		#define LOG_LEVEL_MAIN 		LOG_LEVEL_ERROR
+	#endif
+	#ifndef LOG_LEVEL_LCD
+		#define LOG_LEVEL_LCD 		LOG_LEVEL_ERROR
+	#endif
+#else
+	#ifndef LOG_LEVEL_DRIVE
+		#define LOG_LEVEL_DRIVE 	LOG_LEVEL_DEBUG
+	#endif
+	#ifndef LOG_LEVEL_MAIN
+		#define LOG_LEVEL_MAIN 		LOG_LEVEL_DEBUG
+	#endif
+	#ifndef LOG_LEVEL_LCD
+		#define LOG_LEVEL_LCD 		LOG_LEVEL_INFO
+	#endif
+#endif
+
+//==========================================================
+// DRIVE
+//==========================================================
+#if LOG_LEVEL_DRIVE >= LOG_LEVEL_ERROR
+	#define DRIVE_ERROR(...) 					writeDebugStreamLine(__VA_ARGS__)
+#else
+	#define DRIVE_ERROR(...)
+#endif
+#if LOG_LEVEL_DRIVE >= LOG_LEVEL_INFO
+	#define DRIVE_INFO(...) 					writeDebugStreamLine(__VA_ARGS__)
+#else
+	#define DRIVE_INFO(...)
+#endif
+#if LOG_LEVEL_DRIVE >= LOG_LEVEL_DEBUG
+	#define DRIVE_DEBUG(...) 					writeDebugStreamLine(__VA_ARGS__)
+	#define DRIVE_EVENT(id, a, b, c) 	logEvent(id, a, b, c)
+#else
+	#define DRIVE_DEBUG(...)
+	#define DRIVE_EVENT(id, a, b, c)
+#endif
+
+//==========================================================
+// MAIN
+//==========================================================
+#if LOG_LEVEL_MAIN >= LOG_LEVEL_ERROR
+	#define MAIN_ERROR(...) 					writeDebugStreamLine(__VA_ARGS__)
+#else
+	#define MAIN_ERROR(...)
+#endif
+#if LOG_LEVEL_MAIN >= LOG_LEVEL_INFO
+	#define MAIN_INFO(...) 						writeDebugStreamLine(__VA_ARGS__)
+#else
+	#define MAIN_INFO(...)
+#endif
+#if LOG_LEVEL_MAIN >= LOG_LEVEL_DEBUG
+	#define MAIN_DEBUG(...) 					writeDebugStreamLine(__VA_ARGS__)
+	#define MAIN_EVENT(id, a, b, c) 	logEvent(id, a, b, c)
+#else
+	#define MAIN_DEBUG(...)
+	#define MAIN_EVENT(id, a, b, c)
+#endif
+
+//==========================================================
+// LCD
+//==========================================================
+#if LOG_LEVEL_LCD >= LOG_LEVEL_ERROR
+	#define LCD_ERROR(...) 						writeDebugStreamLine(__VA_ARGS__)
+#else
+	#define LCD_ERROR(...)
+#endif
+#if LOG_LEVEL_LCD >= LOG_LEVEL_INFO
+	#define LCD_INFO(...) 						writeDebugStreamLine(__VA_ARGS__)
+#else
+	#define LCD_INFO(...)
+#endif
+#if LOG_LEVEL_LCD >= LOG_LEVEL_DEBUG
+	#define LCD_DEBUG(...) 						writeDebugStreamLine(__VA_ARGS__)
+#else
+	#define LCD_DEBUG(...)
+#endif
@@ -0,0 +1,159 @@
+/*
+		EventLog.h
+		Binary event log for the hot paths of the drive code.
+
+		writeDebugStreamLine formats the text and waits for room in
+		the debug stream, right in the middle of the control loop.
+		logEvent only stores a fixed size record into a ring of
+		LOG_SIZE records (EVENT LOG in SentinalGlobals.h):
+			logTime[]			... nSysTime of the event
+			logId[]				... LOG_XXX below
+			logArgA/B/C[]	... integer arguments, meaning per LOG_XXX
+		and the low priority logDrain task writes them out as text,
+		LOG_DRAIN_MAX records every LOG_DRAIN_PERIOD.
+
+		No locks: only the main task calls logEvent, and only
+		logDrain moves logTail. logEvent fills the record first and
+		moves logHead after, so logDrain never sees half a record.
+		When the ring is full the new record is dropped and counted
+		in logDropped, which logDrain reports.
+*/
+
+static const short LOG_MOVE_DISTANCE 					= 1;	// speed, distance/100 in
+static const short LOG_ADJUST_POWER 					= 2;	// speed, avgDistance/100 in, motors
+static const short LOG_SET_SPEED 							= 3;	// wheel 0 .. 3 RF LF RR LR, speed
+static const short LOG_MOVE_FORWARD 					= 4;	// speed, ms, distance/100 in
+static const short LOG_MOVE_BACKWARD 					= 5;	// speed, ms, distance/100 in
+static const short LOG_MOVE_FORWARD_REACT 		= 6;	// speed
+static const short LOG_MOVE_BACKWARD_REACT 		= 7;	// speed
+static const short LOG_MOVE_DIAGONAL_FR 			= 8;	// speed, ms
+static const short LOG_MOVE_DIAGONAL_FL 			= 9;	// speed, ms
+static const short LOG_MOVE_DIAGONAL_RR 			= 10;	// speed, ms
+static const short LOG_MOVE_DIAGONAL_RL 			= 11;	// speed, ms
+static const short LOG_MOVE_TRAVERSE_RIGHT 		= 12;	// speed, ms, distance/100 in
+static const short LOG_MOVE_TRAVERSE_LEFT 		= 13;	// speed, ms, distance/100 in
+static const short LOG_MOVE_TRAVERSE_RIGHT_REACT = 14;	// speed
+static const short LOG_MOVE_TRAVERSE_LEFT_REACT = 15;	// speed
+static const short LOG_MOVE_ROTATE_CW 				= 16;	// speed, ms
+static const short LOG_MOVE_ROTATE_CCW 				= 17;	// speed, ms
+static const short LOG_FRONT_BUMPER 					= 18;	// pressed
+
+static long 	logTime[LOG_SIZE];
+static short 	logId[LOG_SIZE];
+static int 		logArgA[LOG_SIZE];
+static int 		logArgB[LOG_SIZE];
+static int 		logArgC[LOG_SIZE];
+static long 	logHead 						= 0;	// records written
+static long 	logTail 						= 0;	// records drained
+static long 	logDropped 					= 0;
+
+// FUNCTION DECLARATIONS
+void logEvent(short id, int a, int b, int c);
+void logWriteRecord(short slot);
+task logDrain();
+
+//==========================================================
+//	logEvent
+//	Store one record, or count it as dropped if the ring is
+//	full. Main task only.
+//==========================================================
+void logEvent(short id, int a, int b, int c)
+{
+	if( logHead - logTail >= LOG_SIZE )
+	{
+		logDropped++;
+		return;
+	}
+
+	short slot = logHead % LOG_SIZE;
+	logTime[slot] 	= nSysTime;
+	logId[slot] 		= id;
+	logArgA[slot] 	= a;
+	logArgB[slot] 	= b;
+	logArgC[slot] 	= c;
+	logHead++;
+} // end logEvent
+
+//==========================================================
+//	logWriteRecord
+//	One record as a line on the debug stream
+//==========================================================
+void logWriteRecord(short slot)
+{
+	long 	t = logTime[slot];
+	int 	a = logArgA[slot];
+	int 	b = logArgB[slot];
+	int 	c = logArgC[slot];
+
+	switch(logId[slot])
+	{
+		case LOG_MOVE_DISTANCE:
+			writeDebugStreamLine("%d moveDistance speed=%d distance=%d", t, a, b);						break;
+		case LOG_ADJUST_POWER:
+			writeDebugStreamLine("%d motorAdjustPower speed=%d avgDistance=%d motors=%d", t, a, b, c);	break;
+		case LOG_SET_SPEED:
+			writeDebugStreamLine("%d set speed wheel %d: %d", t, a, b);											break;
+		case LOG_MOVE_FORWARD:
+			writeDebugStreamLine("%d moveForward speed=%d ms=%d distance=%d", t, a, b, c);			break;
+		case LOG_MOVE_BACKWARD:
+			writeDebugStreamLine("%d moveBackward speed=%d ms=%d distance=%d", t, a, b, c);			break;
+		case LOG_MOVE_FORWARD_REACT:
+			writeDebugStreamLine("%d moveForwardReact speed=%d", t, a);													break;
+		case LOG_MOVE_BACKWARD_REACT:
+			writeDebugStreamLine("%d moveBackwardReact speed=%d", t, a);												break;
+		case LOG_MOVE_DIAGONAL_FR:
+			writeDebugStreamLine("%d moveDiagonalFrontRight speed=%d ms=%d", t, a, b);					break;
+		case LOG_MOVE_DIAGONAL_FL:
+			writeDebugStreamLine("%d moveDiagonalFrontLeft speed=%d ms=%d", t, a, b);						break;
+		case LOG_MOVE_DIAGONAL_RR:
+			writeDebugStreamLine("%d moveDiagonalRearRight speed=%d ms=%d", t, a, b);						break;
+		case LOG_MOVE_DIAGONAL_RL:
+			writeDebugStreamLine("%d moveDiagonalRearLeft speed=%d ms=%d", t, a, b);						break;
+		case LOG_MOVE_TRAVERSE_RIGHT:
+			writeDebugStreamLine("%d moveTraverseRight speed=%d ms=%d distance=%d", t, a, b, c);	break;
+		case LOG_MOVE_TRAVERSE_LEFT:
+			writeDebugStreamLine("%d moveTraverseLeft speed=%d ms=%d distance=%d", t, a, b, c);	break;
+		case LOG_MOVE_TRAVERSE_RIGHT_REACT:
+			writeDebugStreamLine("%d moveTraverseRightReact speed=%d", t, a);										break;
+		case LOG_MOVE_TRAVERSE_LEFT_REACT:
+			writeDebugStreamLine("%d moveTraverseLeftReact speed=%d", t, a);										break;
+		case LOG_MOVE_ROTATE_CW:
+			writeDebugStreamLine("%d moveRotateClockWise speed=%d ms=%d", t, a, b);							break;
+		case LOG_MOVE_ROTATE_CCW:
+			writeDebugStreamLine("%d moveRotateCounterClockWise speed=%d ms=%d", t, a, b);			break;
+		case LOG_FRONT_BUMPER:
+			writeDebugStreamLine("%d frontBumperPressed %d", t, a);															break;
+		default:
+			writeDebugStreamLine("%d log event %d: %d %d %d", t, logId[slot], a, b, c);				break;
+	} // end switch
+} // end logWriteRecord
+
+//==========================================================
+//	logDrain
+//	Writes the logged records out as text, off the control
+//	loop. Start at kLowPriority.
+//==========================================================
+task logDrain()
+{
+	long 	droppedShown 	= 0;
+	short sent 					= 0;
+
+	while( true )
+	{
+		sent = 0;
+		while( logTail < logHead && sent < LOG_DRAIN_MAX )
+		{
+			logWriteRecord( logTail % LOG_SIZE );
+			logTail++;
+			sent++;
+		}
+
+		if( logDropped != droppedShown )
+		{
+			droppedShown = logDropped;
+			writeDebugStreamLine("log: %d records dropped so far", droppedShown);
+		}
+
+		wait1Msec(LOG_DRAIN_PERIOD);
+	} // end while
+} // end logDrain
@@ -0,0 +1,433 @@
+/*
+		Explorer.h
+		Frontier based autonomous exploration for exploreMode.
+
+		A frontier cell is a free map cell with an unknown neighbor: the
+		edge of what the robot has seen. The explorer repeats
+		-	SWEEP		turn once in place (SonarScan.h) to map around the robot
+		-	SELECT	score every frontier in the whole grid window and pick
+							the best one:
+								score = EXPLORE_GAIN_WEIGHT * unknown cells around it
+												- distance to drive
+							frontiers that could not be reached are skipped
+		-	DRIVE		plan a path there (PathPlanner.h) and follow it with
+							pure pursuit (PathFollower.h), with the plan repaired
+							as the map grows
+		until no frontier is left (DONE).
+
+		The search covers EXPLORE_SCAN_ROWS rows of the window per tick,
+		so a full search takes MAP_SIZE / EXPLORE_SCAN_ROWS ticks, and
+		plans at most one goal per tick. A frontier further than
+		EXPLORE_RANGE does not fit the plan grid with the robot: the
+		goal is then the point EXPLORE_RANGE toward it, and the next
+		search after the sweep there picks up from closer.
+
+		The map is updated from the sonars on every tick, in every state.
+
+		Throughput is reported as square meters mapped per minute: the
+		known cells of the window and the map store, less those known
+		when exploreStart was called, times the cell area, over the time
+		since. EXPLORE_AREA_TARGET is the rate it should keep up, the
+		done message shows the two side by side.
+*/
+
+static short 	exploreState 					= EXPLORE_SELECT;
+static float 	exploreGoalX 					= 0.0;
+static float 	exploreGoalY 					= 0.0;
+static float 	exploreHeading 				= 90.0;	// heading held while driving
+static long 	exploreReplanTime 		= 0;
+static long 	exploreStartTime 			= 0;
+static long 	exploreKnownStart 		= 0;	// known cells at exploreStart
+static short 	exploreGoalCount 			= 0;
+static int 		exploreFrontierX 			= 0;	// world map cell the goal leads to
+static int 		exploreFrontierY 			= 0;
+
+// goals that could not be reached, world map cells
+static int 		exploreFailedX[EXPLORE_FAILED_MAX];
+static int 		exploreFailedY[EXPLORE_FAILED_MAX];
+static short 	exploreFailedNext 		= 0;
+
+// frontier search in progress, world map cells
+static int 		exploreSearchX 				= 0;	// window origin when the search started
+static int 		exploreSearchY 				= 0;
+static int 		exploreRobotX 				= 0;
+static int 		exploreRobotY 				= 0;
+static short 	exploreSearchRow 			= 0;	// next row to search
+static short 	exploreAttempt 				= 0;	// goals tried
+static long 	exploreSelectTime 		= 0;
+static bool 	bExploreFound 				= false;
+static float 	exploreBestScore 			= 0.0;
+static int 		exploreBestX 					= 0;
+static int 		exploreBestY 					= 0;
+
+// FUNCTION DECLARATIONS
+void 	exploreStart();
+bool 	exploreIsFrontier(int cellX, int cellY);
+short exploreGain(int cellX, int cellY);
+bool 	exploreFailedBefore(int cellX, int cellY);
+void 	exploreMarkFailed();
+void 	exploreSelectStart();
+void 	exploreSearchRestart();
+void 	exploreScoreCell(int cellX, int cellY);
+bool 	exploreTryGoal();
+short exploreSelectStep();
+void 	exploreLoadPath(bool bNewGoal);
+short exploreStep();
+float exploreAreaPerMinute();
+
+//==========================================================
+//	exploreStart
+//	Start exploring from the current pose, adding to the map
+//	built so far
+//==========================================================
+void exploreStart()
+{
+	writeDebugStreamLine("exploreStart");
+
+	mapStart();
+
+	for( int i = 0; i < EXPLORE_FAILED_MAX; i++ )
+	{
+		exploreFailedX[i] = 0x7FFF;
+		exploreFailedY[i] = 0x7FFF;
+	}
+	exploreFailedNext = 0;
+
+	exploreStartTime 	= nSysTime;
+	exploreKnownStart = mapKnownCellsAll();
+	exploreGoalCount 	= 0;
+	exploreHeading 		= odomHeading;
+
+	scanSweepStart();
+	exploreState = EXPLORE_SWEEP;
+} // end exploreStart
+
+//==========================================================
+//	exploreIsFrontier
+//	true if the cell is free and has an unknown neighbor
+//==========================================================
+bool exploreIsFrontier(int cellX, int cellY)
+{
+	if( mapGetState(cellX, cellY) != MAP_STATE_FREE )
+		return false;
+
+	return mapGetState(cellX + 1, cellY) == MAP_STATE_UNKNOWN ||
+				 mapGetState(cellX - 1, cellY) == MAP_STATE_UNKNOWN ||
+				 mapGetState(cellX, cellY + 1) == MAP_STATE_UNKNOWN ||
+				 mapGetState(cellX, cellY - 1) == MAP_STATE_UNKNOWN;
+} // end exploreIsFrontier
+
+//==========================================================
+//	exploreGain
+//	Unknown cells within EXPLORE_GAIN_RADIUS of the cell,
+//	what the robot can hope to learn by going there
+//==========================================================
+short exploreGain(int cellX, int cellY)
+{
+	short gain = 0;
+
+	for( int y = cellY - EXPLORE_GAIN_RADIUS; y <= cellY + EXPLORE_GAIN_RADIUS; y++ )
+	{
+		for( int x = cellX - EXPLORE_GAIN_RADIUS; x <= cellX + EXPLORE_GAIN_RADIUS; x++ )
+		{
+			if( mapGetState(x, y) == MAP_STATE_UNKNOWN )
+				gain++;
+		}
+	}
+
+	return gain;
+} // end exploreGain
+
+//==========================================================
+//	exploreFailedBefore
+//	true if the cell is near a goal that could not be reached
+//==========================================================
+bool exploreFailedBefore(int cellX, int cellY)
+{
+	for( int i = 0; i < EXPLORE_FAILED_MAX; i++ )
+	{
+		if( abs(cellX - exploreFailedX[i]) <= EXPLORE_GAIN_RADIUS &&
+				abs(cellY - exploreFailedY[i]) <= EXPLORE_GAIN_RADIUS )
+			return true;
+	}
+
+	return false;
+} // end exploreFailedBefore
+
+//==========================================================
+//	exploreMarkFailed
+//	Remember the frontier of the current goal as unreachable,
+//	the oldest failed goal is forgotten
+//==========================================================
+void exploreMarkFailed()
+{
+	exploreFailedX[exploreFailedNext] = exploreFrontierX;
+	exploreFailedY[exploreFailedNext] = exploreFrontierY;
+	exploreFailedNext = (exploreFailedNext + 1) % EXPLORE_FAILED_MAX;
+} // end exploreMarkFailed
+
+//==========================================================
+//	exploreSelectStart
+//	Start looking for the next goal, see exploreSelectStep
+//==========================================================
+void exploreSelectStart()
+{
+	odometryUpdate();
+
+	exploreSelectTime = nSysTime;
+	exploreAttempt 		= 0;
+	exploreSearchRestart();
+} // end exploreSelectStart
+
+//==========================================================
+//	exploreSearchRestart
+//	Search the window again from the first row. The window
+//	and robot cells are kept for the whole search, the map
+//	may scroll in between.
+//==========================================================
+void exploreSearchRestart()
+{
+	exploreSearchX 		= mapOriginX;
+	exploreSearchY 		= mapOriginY;
+	exploreRobotX 		= mapWorldToCell(odomX);
+	exploreRobotY 		= mapWorldToCell(odomY);
+	exploreSearchRow 	= 0;
+	bExploreFound 		= false;
+	exploreBestScore 	= 0.0;
+} // end exploreSearchRestart
+
+//==========================================================
+//	exploreScoreCell
+//	Keep the cell as the best goal so far if it is a
+//	frontier that scores higher
+//==========================================================
+void exploreScoreCell(int cellX, int cellY)
+{
+	if( !exploreIsFrontier(cellX, cellY) || exploreFailedBefore(cellX, cellY) )
+		return;
+
+	float dx = (cellX - exploreRobotX) * MAP_CELL_SIZE;
+	float dy = (cellY - exploreRobotY) * MAP_CELL_SIZE;
+	float distance = sqrt(dx * dx + dy * dy);
+	if( distance < EXPLORE_MIN_DISTANCE )
+		return;
+
+	float score = EXPLORE_GAIN_WEIGHT * exploreGain(cellX, cellY) - distance;
+	if( !bExploreFound || score > exploreBestScore )
+	{
+		bExploreFound 		= true;
+		exploreBestScore 	= score;
+		exploreBestX 			= cellX;
+		exploreBestY 			= cellY;
+	}
+} // end exploreScoreCell
+
+//==========================================================
+//	exploreTryGoal
+//	Plan a path toward the best frontier found, at most
+//	EXPLORE_RANGE of it.
+//	Returns false if there is no path.
+//==========================================================
+bool exploreTryGoal()
+{
+	exploreFrontierX 	= exploreBestX;
+	exploreFrontierY 	= exploreBestY;
+	exploreGoalX 			= (exploreBestX + 0.5) * MAP_CELL_SIZE;
+	exploreGoalY 			= (exploreBestY + 0.5) * MAP_CELL_SIZE;
+
+	float dx = exploreGoalX - odomX;
+	float dy = exploreGoalY - odomY;
+	float distance = sqrt(dx * dx + dy * dy);
+	if( distance > EXPLORE_RANGE )
+	{
+		exploreGoalX = odomX + dx * EXPLORE_RANGE / distance;
+		exploreGoalY = odomY + dy * EXPLORE_RANGE / distance;
+	}
+
+	if( !plannerInit(odomX, odomY, exploreGoalX, exploreGoalY, exploreHeading) )
+		return false;
+
+	writeDebugStreamLine("explore goal %d: %d, %d score %d, %d in, %d ms",
+												exploreGoalCount, exploreBestX, exploreBestY,
+												(int)exploreBestScore, (int)distance,
+												nSysTime - exploreSelectTime);
+	exploreGoalCount += 1;
+	exploreReplanTime = nSysTime;
+	exploreLoadPath(true);
+	return true;
+} // end exploreTryGoal
+
+//==========================================================
+//	exploreSelectStep
+//	One tick of looking for the next goal: search the next
+//	EXPLORE_SCAN_ROWS rows of the window, or once the whole
+//	window is done plan a path to the best frontier.
+//	Returns EXPLORE_SELECT_FOUND with the path loaded,
+//	EXPLORE_SELECT_NONE if there is no frontier left to try,
+//	else EXPLORE_SELECT_RUNNING.
+//==========================================================
+short exploreSelectStep()
+{
+	if( exploreSearchRow < MAP_SIZE )
+	{
+		int lastRow = exploreSearchRow + EXPLORE_SCAN_ROWS;
+		if( lastRow > MAP_SIZE )
+			lastRow = MAP_SIZE;
+
+		for( int y = exploreSearchRow; y < lastRow; y++ )
+		{
+			for( int x = 0; x < MAP_SIZE; x++ )
+			{
+				exploreScoreCell(exploreSearchX + x, exploreSearchY + y);
+			}
+		}
+
+		exploreSearchRow = lastRow;
+		return EXPLORE_SELECT_RUNNING;
+	}
+
+	if( !bExploreFound )
+	{
+		writeDebugStreamLine("exploreSelectStep none left, %d ms",
+													nSysTime - exploreSelectTime);
+		return EXPLORE_SELECT_NONE;
+	}
+
+	if( exploreTryGoal() )
+		return EXPLORE_SELECT_FOUND;
+
+	// search again without it
+	exploreMarkFailed();
+	exploreAttempt += 1;
+	if( exploreAttempt >= EXPLORE_FAILED_MAX )
+	{
+		writeDebugStreamLine("exploreSelectStep no reachable frontier");
+		return EXPLORE_SELECT_NONE;
+	}
+
+	exploreSearchRestart();
+	return EXPLORE_SELECT_RUNNING;
+} // end exploreSelectStep
+
+//==========================================================
+//	exploreLoadPath
+//	Hand the planned path to the path follower, holding
+//	exploreHeading all the way
+//==========================================================
+void exploreLoadPath(bool bNewGoal)
+{
+	pursuitClear();
+	for( int i = 0; i < planPathLength; i++ )
+		pursuitAddWaypoint(planPathX[i], planPathY[i], exploreHeading);
+
+	if( bNewGoal )
+		pursuitStart(EXPLORE_SPEED);
+	else
+		pursuitReplaced();
+} // end exploreLoadPath
+
+//==========================================================
+//	exploreStep
+//	One control tick of the explorer, every
+//	EXPLORE_CONTROL_PERIOD. Returns the explorer state.
+//==========================================================
+short exploreStep()
+{
+	short selectResult;
+
+	mapUpdateStep();
+
+	switch(exploreState)
+	{
+	case EXPLORE_SWEEP:
+		if( !scanSweepStep() )
+			break;
+
+		if( bScanFailed )
+		{
+			// a dead IEC, do not drive on it
+			writeDebugStreamLine("explore stopped, sweep IEC error");
+			exploreState = EXPLORE_DONE;
+		}
+		else
+		{
+			exploreSelectStart();
+			exploreState = EXPLORE_SELECT;
+		}
+		break;
+
+	case EXPLORE_SELECT:
+		moveStopReact();
+		selectResult = exploreSelectStep();
+		if( selectResult == EXPLORE_SELECT_FOUND )
+		{
+			exploreState = EXPLORE_DRIVE;
+		}
+		else if( selectResult == EXPLORE_SELECT_NONE )
+		{
+			writeDebugStreamLine("explore done, %d goals, %f m2/min, target %f",
+														exploreGoalCount, exploreAreaPerMinute(),
+														EXPLORE_AREA_TARGET);
+			exploreState = EXPLORE_DONE;
+		}
+		break;
+
+	case EXPLORE_DRIVE:
+		// EMERGENCY!!! COLLISION DETECTED
+		if( collisionDetected() )
+		{
+			moveStopReact();
+			exploreMarkFailed();
+			exploreSelectStart();
+			exploreState = EXPLORE_SELECT;
+			break;
+		}
+
+		// repair the plan as the map fills in
+		if( nSysTime - exploreReplanTime > EXPLORE_REPLAN_PERIOD )
+		{
+			exploreReplanTime = nSysTime;
+			if( !plannerReplan(odomX, odomY) )
+			{
+				moveStopReact();
+				exploreMarkFailed();
+				exploreSelectStart();
+				exploreState = EXPLORE_SELECT;
+				break;
+			}
+			exploreLoadPath(false);
+		}
+
+		if( pursuitStep() )
+		{
+			pursuitReport("explore goal");
+			scanSweepStart();
+			exploreState = EXPLORE_SWEEP;
+		}
+		break;
+
+	case EXPLORE_DONE:
+	default:
+		moveStopReact();
+		break;
+	} // end switch
+
+	return exploreState;
+} // end exploreStep
+
+//==========================================================
+//	exploreAreaPerMinute
+//	Map area in square meters made known per minute of
+//	exploring, what was known before does not count
+//==========================================================
+float exploreAreaPerMinute()
+{
+	float minutes = (nSysTime - exploreStartTime) / 60000.0;
+	if( minutes <= 0.0 )
+		return 0.0;
+
+	// MAP_CELL_SIZE inches per side, 39.37 inches per meter
+	float cellArea = (MAP_CELL_SIZE / 39.37) * (MAP_CELL_SIZE / 39.37);
+
+	return (mapKnownCellsAll() - exploreKnownStart) * cellArea / minutes;
+} // end exploreAreaPerMinute
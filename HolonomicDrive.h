@@ -34,6 +34,8 @@
 // including LCDManager.h will also
 // include SentinalGlobals.h
 //#include "SentinalGlobals.h"
+#include "Odometry.h"
+#include "EventLog.h"
 
 // CLEANUP, RESET FUNCTIONS
 void resetMotorEncoders();
@@ -45,7 +47,13 @@ void moveDistance(int speed, 			// desired speed
 									short dir_RR,		// direction LF wheel
 									short dir_LF,		// direction RR wheel
 									short dir_LR );	// direction LR wheel
-
+short moveDistanceStep(	float distance,
+												short dir_RF,
+												short dir_RR,
+												short dir_LF,
+												short dir_LR,
+												float *actualDistance );
+void driveLogBenchmark(int passes);
 
 void motorAdjustPower(		int speed, 			// desired speed
 													float *actualDistance, // array
@@ -72,6 +80,22 @@ void moveTraverseLeft(				short speed,
 															float distance) ; // inches
 void moveTraverseRightReact(	short speed	);
 void moveTraverseLeftReact(		short speed );
+
+// COMBINED MOTION
+void moveMecanumReact(				int speedForward,
+															int speedStrafe,
+															int speedRotate );
+void moveFieldReact(					float speedX,
+															float speedY,
+															float holdHeading );
+void moveStopReact();
+void driveSetPower(						int powerLF,
+															int powerLR,
+															int powerRF,
+															int powerRR );
+void driveStartTransition();
+void driveSlewStep();
+int 	driveSlewToward(				int power, int target, int maxStep);
 void moveDiagonalFrontLeft(		short speed, int ms);
 void moveDiagonalFrontRight(	short speed, int ms);
 void moveDiagonalRearRight(		short speed, int ms);
@@ -106,15 +130,20 @@ bool collisionDetected();
 
 //====================================================================
 //	resetMotorEncoders
-//
+//	The travel since the last odometry update is added to the
+//	pose first, so resetting the IECs does not lose it.
 //
 //====================================================================
 void resetMotorEncoders()
 {
+	hogCPU();
+	odometryIntegrate();
 	resetMotorEncoder(motor_RF);
 	resetMotorEncoder(motor_LF);
 	resetMotorEncoder(motor_RR);
 	resetMotorEncoder(motor_LR);
+	odometryClearEncoders();
+	releaseCPU();
 }
 
 //====================================================================
@@ -142,7 +171,7 @@ void moveDistance(	int speed, 			// desired speed
 										short dir_LF,		// direction RR wheel
 										short dir_LR )	// direction LR wheel
 {
-	writeDebugStreamLine("moveDistance ");
+	DRIVE_EVENT(LOG_MOVE_DISTANCE, speed, (int)(distance * 100), 0);
 
 	// when DIRECTION is DIRECTION_FRONT or DIRECTION_REAR
 	// then use default behavior for linear forward or backward
@@ -151,7 +180,6 @@ void moveDistance(	int speed, 			// desired speed
 	// establish local variables for the feedback and control system
 	float diffArray[] 			= { 0.0, 0.0, 0.0, 0.0 };
 	float actualDistance[]	= { 0.0, 0.0, 0.0, 0.0 };
-	bool b_distanceAchieved = false;
 	short activeMotorCount = 0;
 
 	resetMotorEncoders();
@@ -216,7 +244,7 @@ void moveDistance(	int speed, 			// desired speed
 
 	if( activeMotorCount == 0 )
 	{
-		writeDebugStreamLine("Error: activeMotorCount %d", activeMotorCount);
+		DRIVE_ERROR("Error: activeMotorCount %d", activeMotorCount);
 		return;
 	}
 
@@ -237,125 +265,168 @@ void moveDistance(	int speed, 			// desired speed
 	//
 	// if DIRECTION == DIRECTION_LEFT
 	//
-	while( true )
+	while( moveDistanceStep(distance, dir_RF, dir_RR, dir_LF, dir_LR,
+													actualDistance) == MOVE_STEP_RUNNING )
 	{
-		// There are 30 Ticks counted per linear inch traveled.
-		// Sample the distance traveled by each wheel
-		// by counting the ticks and dividing by 30
-		if( dir_RF != 0  )
-		{
-			actualDistance[0] = getMotorEncoder(motor_RF)
-											/MOVEMENT_LINEAR_ADJUSTER;
-		}
+		// Use this function if we want to adjust the power
+		// to each motor using negative closed loop feedback
+		/**
+		motorAdjustPower(	speed,
+											actualDistance,
+											b_RF, b_LF, b_RR, b_LR,
+											activeMotorCount);
+		*/
 
-		if( dir_LF != 0  )
-		{
-			actualDistance[1] = getMotorEncoder(motor_LF)
-										/MOVEMENT_LINEAR_ADJUSTER;
-		}
+		wait1Msec(50);
+	} // end while
 
-		if( dir_RR != 0 )
-		{
-			actualDistance[2] = getMotorEncoder(motor_RR)
-									/MOVEMENT_LINEAR_ADJUSTER;
-		}
+	resetMotorEncoders();
+	stopAllMotors();
+} // end moveDistance
 
-		if( dir_LR != 0)
-		{
-			actualDistance[3] = getMotorEncoder(motor_LR)
+//====================================================================
+//	moveDistanceStep
+//	One pass of the moveDistance loop: read the IECs of the
+//	wheels that turn into actualDistance and check whether the
+//	move is done or has to be given up.
+//	Returns MOVE_STEP_RUNNING, MOVE_STEP_DONE or MOVE_STEP_ABORT.
+//	The caller stops the motors.
+//====================================================================
+short moveDistanceStep(	float distance,	// distance in inches
+												short dir_RF,		// direction RF wheel
+												short dir_RR,		// direction RR wheel
+												short dir_LF,		// direction LF wheel
+												short dir_LR,		// direction LR wheel
+												float *actualDistance )
+{
+	// There are 30 Ticks counted per linear inch traveled.
+	// Sample the distance traveled by each wheel
+	// by counting the ticks and dividing by 30
+	if( dir_RF != 0  )
+	{
+		actualDistance[0] = getMotorEncoder(motor_RF)
 										/MOVEMENT_LINEAR_ADJUSTER;
-		}
+	}
 
-		// EMERGENCY!!! COLLISION DETECTED
-		if( collisionDetected() )
-		{
-			stopAllMotors();
-			resetMotorEncoders();
+	if( dir_LF != 0  )
+	{
+		actualDistance[1] = getMotorEncoder(motor_LF)
+									/MOVEMENT_LINEAR_ADJUSTER;
+	}
 
-			// Write something to the LCD
-			// to do ...
+	if( dir_RR != 0 )
+	{
+		actualDistance[2] = getMotorEncoder(motor_RR)
+								/MOVEMENT_LINEAR_ADJUSTER;
+	}
 
-			// exit from function
-			return;
-		}
+	if( dir_LR != 0)
+	{
+		actualDistance[3] = getMotorEncoder(motor_LR)
+									/MOVEMENT_LINEAR_ADJUSTER;
+	}
 
+	// EMERGENCY!!! COLLISION DETECTED
+	if( collisionDetected() )
+	{
+		// Write something to the LCD
+		// to do ...
+		return MOVE_STEP_ABORT;
+	}
 
-		// Check to see if any wheels have travelled far enough
-		for( int i = 0; i < 4; i++ )
+	// Check to see if any wheels have travelled far enough
+	for( int i = 0; i < 4; i++ )
+	{
+	  // establish a local variable for actual distance
+	  // traveled for each wheel
+		// use abs() in to keep the math positive
+	  // under forward or backward travel, we use
+	  // default linear measurement.
+		float actualDistanceVar = abs(actualDistance[i]);
+
+		// after the Timer T4 has counted 1 second, we check
+		// for any movement in the IECs
+		// If no movement in the IECs, then we terminate
+		// this function to eliminate the possibility of
+		// an infinite moving action
+		if( time1[T4] > IEC_ERROR_TIMEOUT &&
+				actualDistanceVar == 0.0    )
 		{
-		  // establish a local variable for actual distance
-		  // traveled for each wheel
-			// use abs() in to keep the math positive
-		  // under forward or backward travel, we use
-		  // default linear measurement.
-			float actualDistanceVar = abs(actualDistance[i]);
-
-			// after the Timer T4 has counted 1 second, we check
-			// for any movement in the IECs
-			// If no movement in the IECs, then we terminate
-			// this function to eliminate the possibility of
-			// an infinite moving action
-			if( time1[T4] > IEC_ERROR_TIMEOUT &&
-					actualDistanceVar == 0.0    )
-			{
-				// we have a problem with an encoder
-				// post a messege to the LCD???
-				// abort this function to prevent a runaway
-				// condition
-				writeDebugStreamLine("moveDistance IEC_ERROR_TIMEOUT ");
-				resetMotorEncoders();
-				stopAllMotors();
-				return;
-			}
+			// we have a problem with an encoder
+			// post a messege to the LCD???
+			// abort to prevent a runaway condition
+			DRIVE_ERROR("moveDistance IEC_ERROR_TIMEOUT ");
+			return MOVE_STEP_ABORT;
+		}
 
-			// for traversling left or right, the actual distance
-			// of the robot traveled will be different from the
-			// actual distance the wheel moved
-			// for Lateral movement, only 30% of the wheel
-			// movement is converted to lateral robot movement
-			// Therefore, multiply the local variable by .33
+		// for traversling left or right, the actual distance
+		// of the robot traveled will be different from the
+		// actual distance the wheel moved
+		// for Lateral movement, only 30% of the wheel
+		// movement is converted to lateral robot movement
+		// Therefore, multiply the local variable by .33
 
-			if( DIRECTION == DIRECTION_RIGHT ||
-					DIRECTION == DIRECTION_LEFT )
-			{
-		  	actualDistanceVar = actualDistanceVar*MOVEMENT_LATERAL_ADJUSTER;
-			}
+		if( DIRECTION == DIRECTION_RIGHT ||
+				DIRECTION == DIRECTION_LEFT )
+		{
+	  	actualDistanceVar = actualDistanceVar*MOVEMENT_LATERAL_ADJUSTER;
+		}
 
+		// If any wheel traveled the distance, we are done
+		if( actualDistanceVar >= distance )
+			return MOVE_STEP_DONE;
+	} // end for loop
 
-			// If any wheel traveled the distance, then break out of loop
-			if( actualDistanceVar >= distance )
-			{
-				b_distanceAchieved = true;
-				resetMotorEncoders();
-				stopAllMotors();
-				break; // break out of for loop
-			} // end if
-		} // end for loop
+	return MOVE_STEP_RUNNING;
+} // end moveDistanceStep
 
-		// if b_distanceAchieved flag is true, then we are done
-		// exit the function
-		if( b_distanceAchieved )
-		{
-			resetMotorEncoders();
-			stopAllMotors();
-			break; // break out of while loop
-		}
+//====================================================================
+//	driveLogBenchmark
+//	Times passes of one moveDistance loop cycle back to back,
+//	moveDistanceStep plus the motorAdjustPower it can call,
+//	and writes the cost of one pass in microseconds to the
+//	debug stream. At the default drive log level a pass logs
+//	five DRIVE_EVENT records, with SENTINAL_RELEASE
+//	(DebugLog.h) none: build once each way to compare.
+//	Speed 0 and uneven wheel distances keep the motors stopped
+//	while every branch of motorAdjustPower runs, and T4 is
+//	cleared so the IEC check does not give up.
+//	Neither call resets the IECs, resetMotorEncoders would
+//	release the CPU, so the CPU stays held and logDrain cannot
+//	write the records out meanwhile. The records of each pass
+//	are thrown away so every pass stores them into the log.
+//	Written directly, so it shows in a release build too.
+//====================================================================
+void driveLogBenchmark(int passes)
+{
+	float actualDistance[] 	= { 1.0, 2.0, 1.0, 2.0 };
+	long 	head 							= logHead;
+	long 	start 						= 0;
+	long 	elapsed 					= 0;
 
-		// Use this function if we want to adjust the power
-		// to each motor using negative closed loop feedback
-		/**
-		motorAdjustPower(	speed,
-											actualDistance,
-											b_RF, b_LF, b_RR, b_LR,
-											activeMotorCount);
-		*/
+	stopAllMotors();
+	clearTimer(T4);
 
-		wait1Msec(50);
-	} // end while
+	hogCPU();
+	start = nSysTime;
+	for( int i = 0; i < passes; i++ )
+	{
+		moveDistanceStep(MOVEMENT_LINEAR_ADJUSTER, 1, 1, 1, 1, actualDistance);
+		actualDistance[0] = 1.0;
+		actualDistance[1] = 2.0;
+		actualDistance[2] = 1.0;
+		actualDistance[3] = 2.0;
+		motorAdjustPower(0, actualDistance, true, true, true, true, 4);
+		logHead = head;
+	}
+	elapsed = nSysTime - start;
+	releaseCPU();
 
-	resetMotorEncoders();
 	stopAllMotors();
-} // end moveDistance
+
+	writeDebugStreamLine("drive log pass: %d us (%d passes in %d ms, drive log level %d)",
+												elapsed * 1000 / passes, passes, elapsed, LOG_LEVEL_DRIVE);
+} // end driveLogBenchmark
 
 
 //====================================================================
@@ -378,7 +449,6 @@ void motorAdjustPower(		int speed, 			// desired speed
 													bool b_LR,			// activate LR wheel
 													short activeMotorCount)
 {
-	writeDebugStreamLine("motorAdjustPower ");
 	// Closed loop
 	// feedback adjustment of the power to each wheel
 	// find the total average ticks and then adjust each
@@ -410,7 +480,7 @@ void motorAdjustPower(		int speed, 			// desired speed
 
 	float avgDistance =	sumDistance / activeMotorCount;
 
-	writeDebugStreamLine("avgDistance %d", avgDistance);
+	DRIVE_EVENT(LOG_ADJUST_POWER, speed, (int)(avgDistance * 100), activeMotorCount);
 
 	float newSpeed = 0.0;
 	int dither = 2;
@@ -428,7 +498,7 @@ void motorAdjustPower(		int speed, 			// desired speed
 		}
 
 		newSpeed  = speed * (speed/(speed * (actualDistance[0]/avgDistance ) + dither ));
-		writeDebugStreamLine("set speed RF: %d", newSpeed);
+		DRIVE_EVENT(LOG_SET_SPEED, 0, (int)newSpeed, 0);
 		motor[motor_RF] = (int)newSpeed;
 	}
 
@@ -444,7 +514,7 @@ void motorAdjustPower(		int speed, 			// desired speed
 		}
 
 		newSpeed  = speed * (speed/(speed * (actualDistance[1]/avgDistance ) + dither ));
-		writeDebugStreamLine("set speed LF: %d", newSpeed);
+		DRIVE_EVENT(LOG_SET_SPEED, 1, (int)newSpeed, 0);
 		motor[motor_LF] = (int)newSpeed;
 	}
 
@@ -459,7 +529,7 @@ void motorAdjustPower(		int speed, 			// desired speed
 			dither = 0;
 		}
 		newSpeed  = speed * (speed/(speed * (actualDistance[2]/avgDistance ) + dither ));
-		writeDebugStreamLine("set speed RR: %d", newSpeed);
+		DRIVE_EVENT(LOG_SET_SPEED, 2, (int)newSpeed, 0);
 		motor[motor_RR] = (int)newSpeed;
 	}
 
@@ -475,7 +545,7 @@ void motorAdjustPower(		int speed, 			// desired speed
 		}
 
 		newSpeed  = speed * (speed/(speed * (actualDistance[3]/avgDistance ) + dither ));
-		writeDebugStreamLine("set speed LR: %d", newSpeed);
+		DRIVE_EVENT(LOG_SET_SPEED, 3, (int)newSpeed, 0);
 		motor[motor_LR] = (int)newSpeed;
 	}
 
@@ -490,7 +560,7 @@ void moveForward(	short speed,
 									int 	ms,
 									float distance) // inches
 {
-	writeDebugStreamLine("moveForward speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_FORWARD, speed, ms, (int)(distance * 100));
 
 	resetMotorEncoders();
 
@@ -553,7 +623,7 @@ void moveBackward(	short speed,
 										int 	ms,
 										float distance) // inches
 {
-	writeDebugStreamLine("moveBackward speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_BACKWARD, speed, ms, (int)(distance * 100));
 
 	resetMotorEncoders();
 
@@ -614,7 +684,7 @@ void moveBackward(	short speed,
 //====================================================================
 void moveForwardReact(	short speed )
 {
-	writeDebugStreamLine("moveForwardReact speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_FORWARD_REACT, speed, 0, 0);
 	resetMotorEncoders();
 	// start the motors, using the designated amount of speed
 	motor[motor_LF]  = speed;
@@ -631,7 +701,7 @@ void moveForwardReact(	short speed )
 //====================================================================
 void moveBackwardReact(	short speed )
 {
-	writeDebugStreamLine("moveBackwardReact speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_BACKWARD_REACT, speed, 0, 0);
 	moveForwardReact( -speed );
 } // end moveBackwardReact
 
@@ -642,7 +712,7 @@ void moveBackwardReact(	short speed )
 //====================================================================
 void moveDiagonalFrontRight( short speed, int ms)
 {
-	writeDebugStreamLine("moveDiagonalFrontRight speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_DIAGONAL_FR, speed, ms, 0);
 
 	DIRECTION = DIRECTION_RIGHT_FRONT;
 
@@ -692,7 +762,7 @@ void moveDiagonalFrontRight( short speed, int ms)
 //====================================================================
 void moveDiagonalFrontLeft( short speed, int ms)
 {
-	writeDebugStreamLine("moveDiagonalFrontLeft speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_DIAGONAL_FL, speed, ms, 0);
 
 	DIRECTION = DIRECTION_LEFT_FRONT;
 
@@ -742,7 +812,7 @@ void moveDiagonalFrontLeft( short speed, int ms)
 //====================================================================
 void moveDiagonalRearRight( short speed, int ms)
 {
-	writeDebugStreamLine("moveDiagonalRearRight speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_DIAGONAL_RR, speed, ms, 0);
 	moveDiagonalFrontLeft(-speed, ms );
 } // end moveDiagonalRearRight
 
@@ -753,7 +823,7 @@ void moveDiagonalRearRight( short speed, int ms)
 //====================================================================
 void moveDiagonalRearLeft( short speed, int ms)
 {
-	writeDebugStreamLine("moveDiagonalRearLeft speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_DIAGONAL_RL, speed, ms, 0);
 	moveDiagonalFrontRight(-speed, ms );
 } // end moveDiagonalRearLeft
 
@@ -766,7 +836,7 @@ void moveTraverseRight(	short speed,
 												int ms,
 												float distance ) // inches
 {
-	writeDebugStreamLine("moveTraverseRight speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_TRAVERSE_RIGHT, speed, ms, (int)(distance * 100));
 
 	resetMotorEncoders();
 
@@ -832,7 +902,7 @@ void moveTraverseLeft(	short speed,
 												int ms,
 												float distance ) // inches
 {
-	writeDebugStreamLine("moveTraverseLeft speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_TRAVERSE_LEFT, speed, ms, (int)(distance * 100));
 	resetMotorEncoders();
 
 	DIRECTION = DIRECTION_LEFT;
@@ -892,7 +962,7 @@ void moveTraverseLeft(	short speed,
 //====================================================================
 void moveTraverseRightReact(	short speed )
 {
-	writeDebugStreamLine("moveTraverseRightReact speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_TRAVERSE_RIGHT_REACT, speed, 0, 0);
 	resetMotorEncoders();
 	// start the motors, using the designated amount of speed
 		motor[motor_RF]  = -speed;
@@ -910,7 +980,7 @@ void moveTraverseRightReact(	short speed )
 //====================================================================
 void moveTraverseLeftReact(	short speed )
 {
-	writeDebugStreamLine("moveTraverseLeftReact speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_TRAVERSE_LEFT_REACT, speed, 0, 0);
 	resetMotorEncoders();
 	// start the motors, using the designated amount of speed
 		motor[motor_RF]  = speed;
@@ -921,6 +991,182 @@ void moveTraverseLeftReact(	short speed )
 
 } // end moveTraverseLeftReact
 
+//====================================================================
+//	moveMecanumReact
+//	Drive forward, strafe and rotate at the same time with a
+//	single motor command (mecanum inverse kinematics).
+//		speedForward	... + forward, - backward
+//		speedStrafe		... + traverse right, - traverse left
+//		speedRotate		... + clockwise, - counter clockwise
+//	The wheel mix matches the moveXXXReact functions above.
+//	If any wheel would exceed full power, all four are scaled
+//	down together so the direction of travel is preserved.
+//	Encoders are NOT reset, so closed loop callers can keep
+//	measuring while the command changes every tick.
+//	Goes through driveSetPower, so it is ramped during a mode
+//	transition.
+//====================================================================
+void moveMecanumReact(	int speedForward,
+												int speedStrafe,
+												int speedRotate )
+{
+	int powerLF = speedForward + speedStrafe + speedRotate;
+	int powerLR = speedForward - speedStrafe + speedRotate;
+	int powerRF = speedForward - speedStrafe - speedRotate;
+	int powerRR = speedForward + speedStrafe - speedRotate;
+
+	// find the largest wheel command
+	int maxPower = abs(powerLF);
+	if( abs(powerLR) > maxPower )
+		maxPower = abs(powerLR);
+	if( abs(powerRF) > maxPower )
+		maxPower = abs(powerRF);
+	if( abs(powerRR) > maxPower )
+		maxPower = abs(powerRR);
+
+	// normalize, keeping the ratio between the wheels
+	if( maxPower > 127 )
+	{
+		powerLF = powerLF * 127 / maxPower;
+		powerLR = powerLR * 127 / maxPower;
+		powerRF = powerRF * 127 / maxPower;
+		powerRR = powerRR * 127 / maxPower;
+	}
+
+	driveSetPower( powerLF, powerLR, powerRF, powerRR );
+
+} // end moveMecanumReact
+
+//====================================================================
+//	moveFieldReact
+//	Translate in the world frame of Odometry.h while holding a
+//	heading, whatever way the robot is facing.
+//		speedX				... + toward DIRECTION_RIGHT of the start pose
+//		speedY				... + toward DIRECTION_FRONT of the start pose
+//		holdHeading		... heading to keep, degrees
+//	Strafing is boosted by MOVEMENT_LATERAL_ADJUSTER so a diagonal
+//	command really goes diagonally.
+//====================================================================
+void moveFieldReact(	float speedX,
+											float speedY,
+											float holdHeading )
+{
+	float heading = degreesToRadians(odomHeading);
+
+	// world vector into the robot frame
+	float forward = speedX * cos(heading) + speedY * sin(heading);
+	float strafe 	= ( speedX * sin(heading) - speedY * cos(heading) )
+									/ MOVEMENT_LATERAL_ADJUSTER;
+
+	// turned counter clockwise of the hold heading: turn clockwise
+	float rotate = MOVEMENT_HEADING_KP * angleDifference(odomHeading, holdHeading);
+
+	moveMecanumReact( (int)forward, (int)strafe, (int)rotate );
+} // end moveFieldReact
+
+//====================================================================
+//	moveStopReact
+//	Stop through driveSetPower like the other React commands,
+//	so the stop is ramped during a mode transition and does
+//	not fight the ramp.
+//====================================================================
+void moveStopReact()
+{
+	driveSetPower( 0, 0, 0, 0 );
+} // end moveStopReact
+
+//====================================================================
+//	driveSetPower
+//	Command the four wheels. Outside a mode transition the
+//	power goes straight to the motors; during one it becomes
+//	the target that driveSlewStep ramps to.
+//====================================================================
+void driveSetPower(	int powerLF,
+										int powerLR,
+										int powerRF,
+										int powerRR )
+{
+	driveTarget[0] = powerLF;
+	driveTarget[1] = powerLR;
+	driveTarget[2] = powerRF;
+	driveTarget[3] = powerRR;
+
+	if( bDriveTransition )
+	{
+		driveSlewStep();
+		return;
+	}
+
+	motor[motor_LF]  = powerLF;
+	motor[motor_LR]  = powerLR;
+	motor[motor_RF]  = powerRF;
+	motor[motor_RR]  = powerRR;
+} // end driveSetPower
+
+//====================================================================
+//	driveStartTransition
+//	Start ramping from what the wheels do now. The target is
+//	a stop until the new mode commands something else, so a
+//	mode that does not drive brings the robot to a smooth halt.
+//====================================================================
+void driveStartTransition()
+{
+	for( int i = 0; i < 4; i++ )
+	{
+		driveTarget[i] = 0;
+	}
+
+	bDriveTransition 		= true;
+	driveTransitionEnd 	= nSysTime + MODE_TRANSITION_TIME;
+	driveSlewTimeLast 	= nSysTime;
+} // end driveStartTransition
+
+//====================================================================
+//	driveSlewStep
+//	Move every wheel toward its target by what DRIVE_SLEW_RATE
+//	allows since the last step. Called by driveSetPower and by
+//	the mode scheduler while a transition is on; the last step
+//	puts the wheels on target and ends the transition.
+//====================================================================
+void driveSlewStep()
+{
+	if( !bDriveTransition )
+		return;
+
+	if( nSysTime >= driveTransitionEnd )
+	{
+		bDriveTransition = false;
+		motor[motor_LF]  = driveTarget[0];
+		motor[motor_LR]  = driveTarget[1];
+		motor[motor_RF]  = driveTarget[2];
+		motor[motor_RR]  = driveTarget[3];
+		return;
+	}
+
+	int maxStep = (int)( DRIVE_SLEW_RATE * (nSysTime - driveSlewTimeLast) );
+	if( maxStep < 1 )
+		return; // not a full step yet, keep the time for the next call
+	driveSlewTimeLast = nSysTime;
+
+	motor[motor_LF]  = driveSlewToward( motor[motor_LF], driveTarget[0], maxStep );
+	motor[motor_LR]  = driveSlewToward( motor[motor_LR], driveTarget[1], maxStep );
+	motor[motor_RF]  = driveSlewToward( motor[motor_RF], driveTarget[2], maxStep );
+	motor[motor_RR]  = driveSlewToward( motor[motor_RR], driveTarget[3], maxStep );
+} // end driveSlewStep
+
+//====================================================================
+//	driveSlewToward
+//	power moved toward target by at most maxStep
+//====================================================================
+int driveSlewToward( int power, int target, int maxStep )
+{
+	if( target > power + maxStep )
+		return power + maxStep;
+	if( target < power - maxStep )
+		return power - maxStep;
+	return target;
+} // end driveSlewToward
+
 
 //================================================================
 //	moveRotateClockWise
@@ -929,7 +1175,7 @@ void moveTraverseLeftReact(	short speed )
 //================================================================
 void moveRotateClockWise( short speed, int ms)
 {
-	writeDebugStreamLine("moveRotateClockWise speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_ROTATE_CW, speed, ms, 0);
 
 	// start the motors, using the designated amount of speed
 	motor[motor_RF]  = -speed;
@@ -979,7 +1225,7 @@ void moveRotateClockWise( short speed, int ms)
 //====================================================================
 void moveRotateCounterClockWise( short speed, int ms)
 {
-	writeDebugStreamLine("moveRotateCounterClockWise speed=%d", speed );
+	DRIVE_EVENT(LOG_MOVE_ROTATE_CCW, speed, ms, 0);
 
 	// start the motors, using the designated amount of speed
 	moveRotateClockWise(-speed, ms);
@@ -995,7 +1241,7 @@ void runDrivingTest(short speed,
 										int pauseMilliseconds,
 										float distance)
 {
-	writeDebugStreamLine("runDrivingTest speed=%d", speed );
+	DRIVE_INFO("runDrivingTest speed=%d", speed );
 
 	runDrivingTestBasic(speed, ms, pauseMilliseconds,
 											true, true, true, true,
@@ -1026,45 +1272,50 @@ short runDrivingTestBasic(	short speed,
 														bool b_traverseLeft,
 														float distance)
 {
-	writeDebugStreamLine("runDrivingTestBasic speed=%d", speed );
+	DRIVE_INFO("runDrivingTestBasic speed=%d", speed );
 
 		// write to the sensor
-	clearLCDLine(0);
-	clearLCDLine(1);
+	lcdClearLine(0);
+	lcdClearLine(1);
 
-	displayLCDCenteredString(0,"Driving Test:");
-	displayLCDCenteredString(1,"Basic");
+	lcdCenteredString(0,"Driving Test:");
+	lcdCenteredString(1,"Basic");
+	lcdCommit();
 
 	wait1Msec(1000);
 
 	if( b_forward )
 	{
-		clearLCDLine(1);
-		displayLCDCenteredString(1, "Moving Forward");
+		lcdClearLine(1);
+		lcdCenteredString(1, "Moving Forward");
+		lcdCommit();
 		moveForward(speed, ms, distance);
 		wait1Msec(pauseMilliseconds);
 	}
 
 	if( b_backward )
 	{
-		clearLCDLine(1);
- 		displayLCDCenteredString(1, "Moving Backward");
+		lcdClearLine(1);
+ 		lcdCenteredString(1, "Moving Backward");
+		lcdCommit();
 		moveBackward(speed, ms, distance);
 		wait1Msec(pauseMilliseconds);
 	}
 
 	if( b_traverseRight )
 	{
-		clearLCDLine(1);
-		displayLCDCenteredString(1, "Traversing Right");
+		lcdClearLine(1);
+		lcdCenteredString(1, "Traversing Right");
+		lcdCommit();
 		moveTraverseRight(speed, ms, distance);
 		wait1Msec(pauseMilliseconds);
 	}
 
 	if( b_traverseLeft )
 	{
-		clearLCDLine(1);
-		displayLCDCenteredString(1, "Traversing Left");
+		lcdClearLine(1);
+		lcdCenteredString(1, "Traversing Left");
+		lcdCommit();
 		moveTraverseLeft(speed, ms, distance);
 	}
 
@@ -1082,7 +1333,7 @@ void runDrivingTestDiagonal(short speed,
 														int ms,
 														int pauseMilliseconds)
 {
-	writeDebugStreamLine("runDrivingTestDiagonal speed=%d", speed );
+	DRIVE_INFO("runDrivingTestDiagonal speed=%d", speed );
 
 	// TEST DIAGONAL MOVEMENT
 	moveDiagonalFrontRight(speed, ms);
@@ -1109,7 +1360,7 @@ void runDrivingTestTurns(	short speed,
 													int ms,
 													int pauseMilliseconds)
 {
-	writeDebugStreamLine("runDrivingTestTurns speed=%d", speed );
+	DRIVE_INFO("runDrivingTestTurns speed=%d", speed );
 
 	moveRotateClockWise(speed, ms);
 	wait1Msec(pauseMilliseconds);
@@ -6,20 +6,51 @@
 	-	Display Menu Options
 	-	Handle input from LCD buttons
 
-	LCD MENU FLOW
-	Exit <- Initial[RemoteControlMode] <-> DriveTest <-> TrackLine <-> Behavioral
-	<-> DiscoveryMode <-> MappingMode -> Initial[RemoteControlMode] -> ...
-
-	This is the menu order and list, which maps to the MODE
-	There will be a starte diagram for the MODE
-	0	Exit
-	1	Initial[RemoteControlMode]  ... Menu Starts Here
-	2	DriveTest
-	3	TrackLine
-	4	Behavioral
-	5	DiscoveryMode
-	6	MappingMode
-	7 DefensiveeMode
+	LCD MENU TREE
+	The menu is a tree of nodes (MENU TREE in SentinalGlobals.h),
+	built by menuTreeInit in Sentinal.c:
+		DRIVE >					RemoteControl, Mapping, Replay, DriveTest,
+										DUMP RECORD
+		AUTONOMOUS >		TrackLine, Behavioral, Discovery, Defensive,
+										Explore, WallFollow, ReturnHome
+		MISSIONS >			one entry per mission in Missions.h
+		STOP MODE
+		EXIT
+	menuStep handles one button press per call and returns at once:
+		left		... previous entry, the parent menu from the first one
+		center	... open a submenu, or pick the entry
+		right		... next entry, back to the first after the last
+	The menu works the same while a mode runs: the mode keeps the
+	first line of the LCD and the menu takes the second. The cursor
+	then starts on STOP MODE.
+	The right button moves the menu when it is let go, because
+	holding it for INPUT_LONG_PRESS_TIME goes to the next telemetry
+	page instead.
+
+	TELEMETRY PAGES
+	While a page is on (TELEMETRY in SentinalGlobals.h) it takes the
+	first line, in place of the mode status or the menu title, and
+	is redrawn every TELEMETRY_PERIOD:
+		V	LF RF LR RR		... wheel speeds, in/s
+		P avg J avg max	... mode tick period and jitter, ms
+		C	main sensors lcd input ... percent busy per task
+		B	now avg				... battery, mV
+		S	F R L Rt			... sonar samples per second
+
+	LCD FRAME
+	Nothing writes to the LCD directly. The lcdXXX functions write
+	into lcdFrame, a back buffer of the 2 x 16 characters in RAM,
+	which costs a few stores and never waits on the LCD. Once a
+	screen is drawn, lcdCommit copies it to lcdShown in one go
+	(under hogCPU). The scheduler commits once per pass, code that
+	draws and then blocks commits itself. The lcdRenderer task
+	takes a copy of lcdShown the same way, compares it against
+	lcdScreen (what the LCD shows) every LCD_RENDER_PERIOD and
+	sends only the characters that differ, at most
+	LCD_RENDER_MAX_CHARS each time. So a line cleared and not yet
+	written again never reaches the LCD, and redrawing a status
+	line with the same text costs no LCD traffic and does not
+	flicker.
 
 	LCD Button Pressed Numeric Input
 	0:  No buttons pressed
@@ -36,24 +67,20 @@
 #include "SentinalGlobals.h"
 
 string OKSELECTION 			= " <    [OK]    > ";
-string OKSELECTIONEXIT 	= "[EXIT]  [OK]  > ";
 string EXIT 						= "     [EXIT]     ";
 string UP								= "[UP]            ";
 string EMPTY 						= " ";
 
 //==========================================================
 // PRIMARY FUNCTION DECLARATIONS
-// These functions will return a MODE, which is one of the
-// global constants shown above, a number 0 through 6
-// These functions are called from the main c program task
-//==========================================================
-short displayLCDChoice_Initial();
-short displayLCDChoice_DriveTest();
-short displayLCDChoice_TrackLine();
-short displayLCDChoice_Behavioral();
-short displayLCDChoice_Discovery();
-short displayLCDChoice_Mapping();
-short displayLCDChoice_Defensive();
+// The menu engine, called from the scheduler in the main
+// c program task
+//==========================================================
+short menuAdd(short parent, string label, short action, short arg);
+short menuFind(short action, short arg);
+void 	menuShow(short node, bool bOverMode);
+short menuStep(short button);
+void 	menuDraw();
 //==========================================================
 // HELPER FUNCTION DECLARATIONS
 // These functions are called by the PRIMARY FUNCTIONS
@@ -63,332 +90,198 @@ void showIECValuesOnLCD(tSensors quadEncoder);
 void showIECValuesOnLCD();
 void showSonarValuesOnLCD();
 void showLineFollowerValuesOnLCD();
+void showLoopTimingOnLCD();
+void showTaskLoadOnLCD();
+void showBatteryOnLCD();
+void showSonarRateOnLCD();
+void showTelemetryOnLCD();
 
 //==========================================================
-// FUNCTIONS FOR LISTENING TO JOYSTICK COMMANDS
-// These commands will override or interrupt the LCD input
+// FUNCTIONS FOR THE LCD FRAME
+// Write into lcdFrame, lcdCommit hands it to lcdRenderer,
+// which puts it on the LCD
 //==========================================================
-short listenJoystick();
+void lcdClearLine(short line);
+void lcdChar(short line, short column, char c);
+void lcdString(short line, short column, char *str);
+void lcdCenteredString(short line, char *str);
+void lcdNumber(short line, short column, long value);
+void lcdCommit();
+task lcdRenderer();
 
-//==========================================================
-// ALL FUNCTION DEFINITIONS FOR THE REST OF THIS FILE
-//==========================================================
+static char lcdFrame[LCD_CELLS];	// being drawn
+static char lcdShown[LCD_CELLS];	// what the LCD should show, committed
+static char lcdScreen[LCD_CELLS];	// what it shows, 0 for unknown
 
 //==========================================================
-// 	displayLCDChoice_Initial
-//
-//
+// FUNCTIONS FOR LISTENING TO THE BUTTONS
+// The joystick buttons 5U, 5D and 6U stand in for the left,
+// center and right LCD buttons
 //==========================================================
-short displayLCDChoice_Initial()
-{
-	writeDebugStreamLine("displayLCDChoice_Initial");
-
-	populateLCDMenu( "REMOTE CONTROL?", OKSELECTIONEXIT );
-	//displayLCDChar(1,0,222); // show the up arrow at the far left
-	//displayLCDChar(1,1,32); // show the up arrow at the far left
-
-	short LCDButton = 0;
-	short joystickBtn = 0;
-
-	// Infinite loop, waiting for user to press button.
-	while(LCDButton == 0 && joystickBtn == 0 )
-	{
-		LCDButton = nLCDButtons;
-		joystickBtn = listenJoystick();
-		wait1Msec(PAUSETIME); // slow things down a bit
-		if( LCDButton > 0 || joystickBtn > 0 )
-			break; // exit the while loop
-	} // end while loop
-
-	//wait1Msec(PAUSETIME); // slow things down a bit
+short readButtons();
+void 	inputQueue(short type, short button);
+short inputNextEvent();
+short inputEventType(short event);
+short inputEventButton(short event);
+task 	inputMonitor();
 
-	if( 			LCDButton == 1 || joystickBtn == 1 ) // 1:  Left button is pressed
-	{
-		ROBOT_MODE = MODE_EXIT;
-		return	MODE_EXIT;
-	}
-	else if( 	LCDButton == 2 || joystickBtn == 2 ) // 2:  Center button is pressed
-	{
-		return MODE_REMOTECONTROL;
-	}
-	else if( 	LCDButton == 4 || joystickBtn == 4 ) // 4:  Right button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_DriveTest();
-	}
-	else
-				return	MODE_EXIT; // exit function, too many buttons pressed simultaneously
-} // end displayLCDChoice_Initial
+// filled by inputMonitor only, emptied by inputNextEvent only
+static short 	inputEvents[INPUT_QUEUE_SIZE];
+static short 	inputHead 					= 0;	// next to fill
+static short 	inputTail 					= 0;	// next to empty
+static long 	inputDropped 				= 0;
 
 //==========================================================
-// 	displayLCDChoice_DriveTest
-//	params - none
-//
+// ALL FUNCTION DEFINITIONS FOR THE REST OF THIS FILE
 //==========================================================
-short displayLCDChoice_DriveTest()
-{
-	writeDebugStreamLine("displayLCDChoice_DriveTest");
-
-	populateLCDMenu("DRIVE TEST?", OKSELECTION);
-
-	short LCDButton = 0;
-	short joystickBtn = 0;
-
-	// Infinite loop, waiting for user to press button.
-	while(LCDButton == 0 && joystickBtn == 0 )
-	{
-		LCDButton = nLCDButtons;
-		joystickBtn = listenJoystick();
-		wait1Msec(PAUSETIME); // slow things down a bit
-		if( LCDButton > 0 || joystickBtn > 0 )
-			break; // exit the while loop
-	} // end while loop
-
-	wait1Msec(PAUSETIME); // slow things down a bit
-
-	if( 			LCDButton == 1 || joystickBtn == 1 ) // 1:  Left button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Initial();
-	}
-	else if( 	LCDButton == 2 || joystickBtn == 2 ) // 2:  Center button is pressed "OK"
-	{
-		return MODE_DRIVETEST;
-	}
-	else if( 	LCDButton == 4 || joystickBtn == 4 ) // 4:  Right button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_TrackLine();
-	}
-	else
-		return MODE_EXIT; // exit function, too many buttons pressed simultaneously
-
-} // end displayLCDChoice_DriveTest
 
 //==========================================================
-// 	displayLCDChoice_TrackLine
-//	params - none
-//
+// 	menuAdd
+//	Add a node as the last child of parent, returns the node
+//	or MENU_NONE if the tree is full
 //==========================================================
-short displayLCDChoice_TrackLine()
+short menuAdd(short parent, string label, short action, short arg)
 {
-	writeDebugStreamLine("displayLCDChoice_TrackLine");
+	if( menuNodeCount >= MENU_NODE_MAX )
+	{
+		LCD_ERROR("menuAdd tree full: %s", label);
+		return MENU_NONE;
+	}
 
-	populateLCDMenu("TRACK LINE?", OKSELECTION);
+	short node = menuNodeCount;
+	menuNodeCount += 1;
 
-	short LCDButton = 0;
-	short joystickBtn = 0;
+	menuLabel[node] 	= label;
+	menuAction[node] 	= action;
+	menuArg[node] 		= arg;
+	menuParent[node] 	= parent;
+	menuChild[node] 	= MENU_NONE;
+	menuNext[node] 		= MENU_NONE;
+	menuPrev[node] 		= MENU_NONE;
 
-	// Infinite loop, waiting for user to press button.
-	while(LCDButton == 0 && joystickBtn == 0 )
-	{
-		LCDButton = nLCDButtons;
-		joystickBtn = listenJoystick();
-		wait1Msec(PAUSETIME); // slow things down a bit
-		if( LCDButton > 0 || joystickBtn > 0 )
-			break; // exit the while loop
-	} // end while loop
+	// the root has no parent
+	if( parent == MENU_NONE )
+		return node;
 
-	wait1Msec(PAUSETIME); // slow things down a bit
-
-	if( 			LCDButton == 1 || joystickBtn == 1 ) // 1:  Left button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_DriveTest();
-	}
-	else if( 	LCDButton == 2 || joystickBtn == 2 ) // 2:  Center button is pressed "OK"
-	{
-		return MODE_TRACKLINE;
-	}
-	else if( 	LCDButton == 4 || joystickBtn == 4 ) // 4:  Right button is pressed
+	if( menuChild[parent] == MENU_NONE )
 	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Behavioral();
+		menuChild[parent] = node;
+		return node;
 	}
-	else
-		return MODE_EXIT; // exit function, too many buttons pressed simultaneously
 
-} // end displayLCDChoice_TrackLine
+	short last = menuChild[parent];
+	while( menuNext[last] != MENU_NONE )
+		last = menuNext[last];
+
+	menuNext[last] 	= node;
+	menuPrev[node] 	= last;
+	return node;
+} // end menuAdd
 
 //==========================================================
-// 	displayLCDChoice_Behavioral
-//	params - none
-//
+// 	menuFind
+//	The first node with this action and argument, MENU_NONE
+//	if there is none
 //==========================================================
-short displayLCDChoice_Behavioral()
+short menuFind(short action, short arg)
 {
-	writeDebugStreamLine("displayLCDChoice_Behavioral");
-
-	populateLCDMenu("BEHAVIORAL?", OKSELECTION);
-
-	short LCDButton = 0;
-	short joystickBtn = 0;
-
-	// Infinite loop, waiting for user to press button.
-	while(LCDButton == 0 && joystickBtn == 0 )
-	{
-		LCDButton = nLCDButtons;
-		joystickBtn = listenJoystick();
-		wait1Msec(PAUSETIME); // slow things down a bit
-		if( LCDButton > 0 || joystickBtn > 0 )
-			break; // exit the while loop
-	} // end while loop
-
-	wait1Msec(PAUSETIME); // slow things down a bit
-
-	if( 			LCDButton == 1 || joystickBtn == 1 ) // 1:  Left button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_TrackLine();
-	}
-	else if( 	LCDButton == 2 || joystickBtn == 2) // 2:  Center button is pressed "OK"
+	for( int i = 0; i < menuNodeCount; i++ )
 	{
-		return MODE_BEHAVIORAL;
+		if( menuAction[i] == action && menuArg[i] == arg )
+			return i;
 	}
-	else if( 	LCDButton == 4 || joystickBtn == 4 ) // 4:  Right button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Discovery();
-	}
-	else
-		return MODE_EXIT; // exit function, too many buttons pressed simultaneously
 
-} // end displayLCDChoice_Behavioral
+	return MENU_NONE;
+} // end menuFind
 
 //==========================================================
-// 	displayLCDChoice_Discovery
-//	params - none
-//
+// 	menuShow
+//	Put the cursor on node and draw the menu, on its own
+//	(bOverMode false) or on the second line under a running
+//	mode
 //==========================================================
-short displayLCDChoice_Discovery()
+void menuShow(short node, bool bOverMode)
 {
-	writeDebugStreamLine("displayLCDChoice_Discovery");
-
-	populateLCDMenu("DISCOVERY?", OKSELECTION);
-
-	short LCDButton = 0;
-	short joystickBtn = 0;
-
-	// Infinite loop, waiting for user to press button.
-	while(LCDButton == 0 && joystickBtn == 0 )
-	{
-		LCDButton = nLCDButtons;
-		joystickBtn = listenJoystick();
-		wait1Msec(PAUSETIME); // slow things down a bit
-		if( LCDButton > 0 || joystickBtn > 0 )
-			break; // exit the while loop
-	} // end while loop
-
-	wait1Msec(PAUSETIME); // slow things down a bit
-
-	if( 			LCDButton == 1 || joystickBtn == 1 ) // 1:  Left button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Behavioral();
-	}
-	else if( 	LCDButton == 2 || joystickBtn == 2 ) // 2:  Center button is pressed "OK"
-	{
-		return MODE_DISCOVERY;
-	}
-	else if( 	LCDButton == 4 || joystickBtn == 4 ) // 4:  Right button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Mapping();
-	}
-	else
-		return MODE_EXIT; // exit function, too many buttons pressed simultaneously
+	if( node != MENU_NONE )
+		menuCursor = node;
+	bMenuOverMode = bOverMode;
 
-} // end displayLCDChoice_Discovery
+	menuDraw();
+} // end menuShow
 
 //==========================================================
-// 	displayLCDChoice_Mapping
-//	params - none
+// 	menuStep
+//	params - button pressed, 1 left, 2 center, 4 right
 //
+//	Move the cursor for one button press and redraw.
+//	Returns the node picked with the center button, or
+//	MENU_NONE. Never waits, so a running mode keeps going.
 //==========================================================
-short displayLCDChoice_Mapping()
+short menuStep(short button)
 {
-	writeDebugStreamLine("displayLCDChoice_Mapping");
-
-	populateLCDMenu("MAPPING?", OKSELECTION);
+	short parent = menuParent[menuCursor];
 
-	short LCDButton = 0;
-	short joystickBtn = 0;
-
-	// Infinite loop, waiting for user to press button.
-	while(LCDButton == 0 && joystickBtn == 0 )
+	if( 			button == 1 ) // 1:  Left button is pressed
 	{
-		LCDButton = nLCDButtons;
-		joystickBtn = listenJoystick();
-		wait1Msec(PAUSETIME); // slow things down a bit
-		if( LCDButton > 0 || joystickBtn > 0 )
-			break; // exit the while loop
-	} // end while loop
-
-	wait1Msec(PAUSETIME); // slow things down a bit
-
-	if( 		LCDButton == 1 	|| joystickBtn == 1 ) // 1:  Left button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Behavioral();
+		if( menuPrev[menuCursor] != MENU_NONE )
+		{
+			menuCursor = menuPrev[menuCursor];
+		}
+		else if( parent != MENU_ROOT )
+		{
+			menuCursor = parent;
+		}
+		else
+		{
+			// top level, wrap round to the last entry
+			while( menuNext[menuCursor] != MENU_NONE )
+				menuCursor = menuNext[menuCursor];
+		}
 	}
-	else if( 	LCDButton == 2 || joystickBtn == 2 ) // 2:  Center button is pressed "OK"
+	else if( 	button == 2 ) // 2:  Center button is pressed "OK"
 	{
-		return MODE_MAPPING;
+		if( menuAction[menuCursor] != MENU_ACTION_SUBMENU )
+			return menuCursor;
+
+		if( menuChild[menuCursor] != MENU_NONE )
+			menuCursor = menuChild[menuCursor];
 	}
-	else if( 	LCDButton == 4 || joystickBtn == 4 ) // 4:  Right button is pressed
+	else if( 	button == 4 ) // 4:  Right button is pressed
 	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Defensive(); // return to initial mode
+		if( menuNext[menuCursor] != MENU_NONE )
+			menuCursor = menuNext[menuCursor];
+		else
+			menuCursor = menuChild[parent];
 	}
 	else
-		return MODE_EXIT; // exit function, too many buttons pressed simultaneously
+	{
+		// nothing pressed
+		return MENU_NONE;
+	}
 
-} // end displayLCDChoice_Mapping
+	menuDraw();
+	return MENU_NONE;
+} // end menuStep
 
 //==========================================================
-// 	displayLCDChoice_Defensive
-//	params - none
-//
+// 	menuDraw
+//	The entry under the cursor, with the button hints when
+//	the menu has the LCD to itself
 //==========================================================
-short displayLCDChoice_Defensive()
+void menuDraw()
 {
-	writeDebugStreamLine("displayLCDChoice_Defensive");
-
-	populateLCDMenu("DEFENSIVE?", OKSELECTION);
-
-	short LCDButton = 0;
-	short joystickBtn = 0;
-
-	// Infinite loop, waiting for user to press button.
-	while(LCDButton == 0 && joystickBtn == 0 )
-	{
-		LCDButton = nLCDButtons;
-		joystickBtn = listenJoystick();
-		wait1Msec(PAUSETIME); // slow things down a bit
-		if( LCDButton > 0 || joystickBtn > 0 )
-			break; // exit the while loop
-	} // end while loop
-
-	wait1Msec(PAUSETIME); // slow things down a bit
-
-	if( 		LCDButton == 1 || joystickBtn == 1) // 1:  Left button is pressed
-	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Mapping();
-	}
-	else if( 	LCDButton == 2 || joystickBtn == 2 ) // 2:  Center button is pressed "OK"
+	if( bMenuOverMode || telemetryPage != TELEMETRY_OFF )
 	{
-		return MODE_DEFENSIVE;
+		lcdClearLine(1);
+		lcdChar(1, 0, '<');
+		lcdString(1, 1, menuLabel[menuCursor]);
+		lcdChar(1, LCD_COLUMNS - 1, '>');
 	}
-	else if( 	LCDButton == 4 || joystickBtn == 4 ) // 4:  Right button is pressed
+	else
 	{
-		ROBOT_MODE = MODE_DECIDING;
-		displayLCDChoice_Initial(); // return to initial mode
+		populateLCDMenu( menuLabel[menuCursor], OKSELECTION );
 	}
-	else
-		return MODE_EXIT; // exit function, too many buttons pressed simultaneously
-
-} // end displayLCDChoice_Defensive
+} // end menuDraw
 
 //==========================================================
 // 	populateLCDMenu
@@ -408,24 +301,20 @@ void populateLCDMenu(char *str1, char *str2)
 	//writeDebugStreamLine("populateLCDMenu");
 
 	// Clear the LCD
-	clearLCDLine(0);
-	clearLCDLine(1);
+	lcdClearLine(0);
+	lcdClearLine(1);
 
 	// Populate first line of LCD with the string parameter
-	setLCDPosition(0,0);
-	displayLCDCenteredString(0, str1);
+	lcdCenteredString(0, str1);
 
 	// Populate second line of LCD
-	setLCDPosition(1,0);
-	displayLCDString(1, 0, str2);
+	lcdString(1, 0, str2);
 
 	if( str2 == EXIT )
 	{
-		displayLCDChar(1,0,197); // show the up arrow at the far left
+		lcdChar(1,0,197); // show the up arrow at the far left
 	}
 
-	wait1Msec(200);
-
 } // end populateLCDMenu
 
 //==========================================================
@@ -441,11 +330,10 @@ void showIECValuesOnLCD(tSensors quadEncoder)
 	// create infinite loop that shows sensor values on LCD
 	//while(true)
 	//{
-		clearLCDLine(0);
+		lcdClearLine(0);
 		//displayLCDNumber(0, 0, nMotorEncoder(motorIEC_LF)	);
 		//displayLCDNumber(0, 9, nMotorEncoder(motorIEC_RF)	);
-		displayLCDNumber(0, 9, quadEncoder	);
-		wait1Msec(200);
+		lcdNumber(0, 9, quadEncoder	);
 	//}
 
 	//clearLCDLine(0);
@@ -464,11 +352,11 @@ void showIECValuesOnLCD(tSensors quadEncoder)
 //==========================================================
 void showSonarValuesOnLCD()
 {
-	clearLCDLine(0);
-	displayLCDString(0,0,"Fr: ");
-	displayLCDNumber( 0, 5, sonarFrontValGlobal);
-	displayLCDString(0,9,"Rr: ");
-	displayLCDNumber( 0, 13, sonarRearValGlobal);
+	lcdClearLine(0);
+	lcdString(0,0,"Fr: ");
+	lcdNumber( 0, 5, sonarFrontValGlobal);
+	lcdString(0,9,"Rr: ");
+	lcdNumber( 0, 13, sonarRearValGlobal);
 }
 
 //==========================================================
@@ -478,10 +366,10 @@ void showSonarValuesOnLCD()
 //==========================================================
 void showLineFollowerValuesOnLCD()
 {
-	clearLCDLine(0);
-	displayLCDNumber( 0, 	0, 	lineFollower1ValGlobal);
-	displayLCDNumber( 0, 	6, 	lineFollower2ValGlobal);
-	displayLCDNumber( 0, 	12, lineFollower3ValGlobal);
+	lcdClearLine(0);
+	lcdNumber( 0, 	0, 	lineFollower1ValGlobal);
+	lcdNumber( 0, 	6, 	lineFollower2ValGlobal);
+	lcdNumber( 0, 	12, lineFollower3ValGlobal);
 }
 
 //==========================================================
@@ -494,22 +382,329 @@ void showLineFollowerValuesOnLCD()
 //==========================================================
 void showIECValuesOnLCD()
 {
-
+	lcdClearLine(0);
+	lcdChar(0, 0, 'V');
+	lcdNumber( 0, 	1, 	(long)telemetryWheelSpeed[1]);	// LF
+	lcdNumber( 0, 	5, 	(long)telemetryWheelSpeed[0]);	// RF
+	lcdNumber( 0, 	9, 	(long)telemetryWheelSpeed[3]);	// LR
+	lcdNumber( 0, 	13, (long)telemetryWheelSpeed[2]);	// RR
 } // end showIECValuesOnLCD
 
-short listenJoystick()
+//==========================================================
+// 	showLoopTimingOnLCD
+//  Mode tick period, average and largest jitter, in ms
+//
+//==========================================================
+void showLoopTimingOnLCD()
+{
+	lcdClearLine(0);
+	lcdChar(0, 0, 'P');
+	lcdNumber( 0, 	1, 	(long)(telemetryLoopPeriod + 0.5));
+	lcdChar(0, 6, 'J');
+	lcdNumber( 0, 	7, 	(long)(telemetryLoopJitter + 0.5));
+	lcdNumber( 0, 	12, (long)telemetryLoopJitterMax);
+} // end showLoopTimingOnLCD
+
+//==========================================================
+// 	showTaskLoadOnLCD
+//  Percent busy of the main, monitorSensors, lcdRenderer and
+//	inputMonitor tasks
+//
+//==========================================================
+void showTaskLoadOnLCD()
+{
+	lcdClearLine(0);
+	lcdChar(0, 0, 'C');
+	for( int i = 0; i < TASK_COUNT; i++ )
+		lcdNumber( 0, 1 + i * 4, telemetryTaskLoad[i]);
+} // end showTaskLoadOnLCD
+
+//==========================================================
+// 	showBatteryOnLCD
+//  Main battery now and averaged, in mV
+//
+//==========================================================
+void showBatteryOnLCD()
+{
+	lcdClearLine(0);
+	lcdChar(0, 0, 'B');
+	lcdNumber( 0, 	2, 	nImmediateBatteryLevel);
+	lcdChar(0, 8, 'A');
+	lcdNumber( 0, 	10, nAvgBatteryLevel);
+} // end showBatteryOnLCD
+
+//==========================================================
+// 	showSonarRateOnLCD
+//  New readings per second of each sonar, SONAR_XXX order
+//
+//==========================================================
+void showSonarRateOnLCD()
 {
-	// default nothing was pressed on joystick
-	int returnVal = 0;
+	lcdClearLine(0);
+	lcdChar(0, 0, 'S');
+	for( int i = 0; i < SONAR_COUNT; i++ )
+		lcdNumber( 0, 1 + i * 4, (long)(telemetrySonarRate[i] + 0.5));
+} // end showSonarRateOnLCD
+
+//==========================================================
+// 	showTelemetryOnLCD
+//  The telemetry page that is on, on the first line
+//
+//==========================================================
+void showTelemetryOnLCD()
+{
+	switch(telemetryPage)
+	{
+		case TELEMETRY_WHEELS: 		showIECValuesOnLCD(); 	break;
+		case TELEMETRY_LOOP: 			showLoopTimingOnLCD(); 	break;
+		case TELEMETRY_CPU: 			showTaskLoadOnLCD(); 		break;
+		case TELEMETRY_BATTERY: 	showBatteryOnLCD(); 		break;
+		case TELEMETRY_SONAR: 		showSonarRateOnLCD(); 	break;
+		default: 																	break;
+	}
+} // end showTelemetryOnLCD
+
+//==========================================================
+// 	readButtons
+//  The buttons held right now, numbered as nLCDButtons,
+//	LCD and joystick together
+//==========================================================
+short readButtons()
+{
+	short buttons = nLCDButtons;
 
 	if( vexRT[Btn5U] == 1 )
-		returnVal = 1; // corresponds to LCD 1
-  else if( vexRT[Btn5D] == 1 )
-  	returnVal = 2; // corresponds to LCD 2
-  else if( vexRT[Btn6U] == 1 )
-  	returnVal = 4;	// corresponds to LCD 4
- 	else
- 		returnVal = 0;
-
-	return returnVal;
-}
+		buttons |= 1; // corresponds to LCD 1
+	if( vexRT[Btn5D] == 1 )
+		buttons |= 2; // corresponds to LCD 2
+	if( vexRT[Btn6U] == 1 )
+		buttons |= 4;	// corresponds to LCD 4
+
+	return buttons;
+} // end readButtons
+
+//==========================================================
+// 	inputQueue
+//  Add an event, dropped and counted if the queue is full.
+//	Only inputMonitor calls this.
+//==========================================================
+void inputQueue(short type, short button)
+{
+	short next = (inputHead + 1) % INPUT_QUEUE_SIZE;
+	if( next == inputTail )
+	{
+		inputDropped += 1;
+		return;
+	}
+
+	inputEvents[inputHead] 	= type * 8 + button;
+	inputHead 							= next;
+} // end inputQueue
+
+//==========================================================
+// 	inputNextEvent
+//  The oldest event not taken yet, INPUT_NONE if there is
+//	none. Never waits.
+//==========================================================
+short inputNextEvent()
+{
+	if( inputTail == inputHead )
+		return INPUT_NONE;
+
+	short event = inputEvents[inputTail];
+	inputTail 	= (inputTail + 1) % INPUT_QUEUE_SIZE;
+	return event;
+} // end inputNextEvent
+
+//==========================================================
+// 	inputEventType
+//  INPUT_PRESS, INPUT_RELEASE or INPUT_LONG_PRESS
+//==========================================================
+short inputEventType(short event)
+{
+	return event / 8;
+} // end inputEventType
+
+//==========================================================
+// 	inputEventButton
+//  1 left, 2 center, 4 right
+//==========================================================
+short inputEventButton(short event)
+{
+	return event % 8;
+} // end inputEventButton
+
+//==========================================================
+// 	inputMonitor
+//  Reads the buttons every INPUT_SAMPLE_PERIOD. A button
+//	counts as pressed or released once it has read the same
+//	for INPUT_DEBOUNCE_TIME, which queues INPUT_PRESS or
+//	INPUT_RELEASE. Held for INPUT_LONG_PRESS_TIME it also
+//	queues INPUT_LONG_PRESS, once per press.
+//	This is the only place the buttons are read.
+//==========================================================
+task inputMonitor()
+{
+	short stable 			= 0;	// debounced buttons
+	short raw 				= 0;
+	short rawLast 		= 0;
+	long 	rawTime 		= nSysTime;
+	long 	pressTime[3];
+	short longSent 		= 0;	// buttons whose long press is queued
+
+	while( true )
+	{
+		raw = readButtons();
+		if( raw != rawLast )
+		{
+			rawLast = raw;
+			rawTime = nSysTime;
+		}
+
+		for( int i = 0; i < 3; i++ )
+		{
+			short button = 1 << i;
+
+			if( (raw & button) != (stable & button) &&
+					nSysTime - rawTime >= INPUT_DEBOUNCE_TIME )
+			{
+				stable ^= button;
+				if( (stable & button) != 0 )
+				{
+					pressTime[i] 	= nSysTime;
+					longSent 		&= ~button;
+					inputQueue(INPUT_PRESS, button);
+				}
+				else
+				{
+					inputQueue(INPUT_RELEASE, button);
+				}
+			}
+
+			if( (stable & button) != 0 && (longSent & button) == 0 &&
+					nSysTime - pressTime[i] >= INPUT_LONG_PRESS_TIME )
+			{
+				longSent |= button;
+				inputQueue(INPUT_LONG_PRESS, button);
+			}
+		} // end for
+
+		bTaskRan[TASK_INPUT] = true;
+		wait1Msec(INPUT_SAMPLE_PERIOD);
+	} // end while
+} // end inputMonitor
+
+//==========================================================
+// 	lcdClearLine
+//  Blank one line of the frame
+//==========================================================
+void lcdClearLine(short line)
+{
+	for( int i = 0; i < LCD_COLUMNS; i++ )
+		lcdFrame[line * LCD_COLUMNS + i] = ' ';
+} // end lcdClearLine
+
+//==========================================================
+// 	lcdChar
+//  One character into the frame, off the line is dropped
+//==========================================================
+void lcdChar(short line, short column, char c)
+{
+	if( line < 0 || line > 1 || column < 0 || column >= LCD_COLUMNS )
+		return;
+
+	lcdFrame[line * LCD_COLUMNS + column] = c;
+} // end lcdChar
+
+//==========================================================
+// 	lcdString
+//  Text into the frame from column on, cut at the end of
+//	the line
+//==========================================================
+void lcdString(short line, short column, char *str)
+{
+	for( int i = 0; str[i] != 0 && column + i < LCD_COLUMNS; i++ )
+		lcdChar(line, column + i, str[i]);
+} // end lcdString
+
+//==========================================================
+// 	lcdCenteredString
+//  Text into the frame, centered on the line
+//==========================================================
+void lcdCenteredString(short line, char *str)
+{
+	short length = strlen(str);
+	if( length > LCD_COLUMNS )
+		length = LCD_COLUMNS;
+
+	lcdString(line, (LCD_COLUMNS - length) / 2, str);
+} // end lcdCenteredString
+
+//==========================================================
+// 	lcdNumber
+//  A number into the frame from column on, like
+//	displayLCDNumber
+//==========================================================
+void lcdNumber(short line, short column, long value)
+{
+	char digits[12];
+
+	sprintf(digits, "%d", value);
+	lcdString(line, column, digits);
+} // end lcdNumber
+
+//==========================================================
+// 	lcdCommit
+//  The frame drawn so far is what the LCD should show
+//==========================================================
+void lcdCommit()
+{
+	hogCPU();
+	for( int i = 0; i < LCD_CELLS; i++ )
+		lcdShown[i] = lcdFrame[i];
+	releaseCPU();
+} // end lcdCommit
+
+//==========================================================
+// 	lcdRenderer
+//  Keeps the LCD in step with lcdShown: every
+//	LCD_RENDER_PERIOD, send the characters that changed, at
+//	most LCD_RENDER_MAX_CHARS of them. The rest go the next
+//	time round.
+//==========================================================
+task lcdRenderer()
+{
+	char 	shown[LCD_CELLS];
+	short sent 		= 0;
+
+	// unknown, so the first pass draws every character
+	for( int i = 0; i < LCD_CELLS; i++ )
+		lcdScreen[i] = 0;
+
+	while( true )
+	{
+		sent 			= 0;
+
+		// one whole committed frame, never half of two
+		hogCPU();
+		for( int i = 0; i < LCD_CELLS; i++ )
+			shown[i] = lcdShown[i];
+		releaseCPU();
+
+		for( int i = 0; i < LCD_CELLS && sent < LCD_RENDER_MAX_CHARS; i++ )
+		{
+			char c = shown[i];
+			if( c == 0 )
+				c = ' ';	// never written
+			if( c == lcdScreen[i] )
+				continue;
+
+			displayLCDChar(i / LCD_COLUMNS, i % LCD_COLUMNS, c);
+			lcdScreen[i] = c;
+			sent++;
+		}
+
+		bTaskRan[TASK_LCD] = true;
+		wait1Msec(LCD_RENDER_PERIOD);
+	} // end while
+} // end lcdRenderer
@@ -0,0 +1,273 @@
+/*
+		LineFollower.h
+		PID line following engine for the three VEX Line Tracking
+		Sensors mounted across the front of the robot.
+
+		LineFollower Sensors, left to right, looking from back of vehicle
+			lineFollower1	... left
+			lineFollower2	... middle
+			lineFollower3	... right
+
+		Every LINE_CONTROL_PERIOD the engine
+		-	computes the centroid of the line under the three sensors
+		-	runs a PID on the lateral (cross track) error
+		-	corrects with a strafe (the mecanum wheels can slide sideways)
+			plus yaw, which keeps the chassis square to the line and turns
+			it through curves; the strafe alone cannot follow a curve
+		If the line is lost, the robot strafes toward the side the line
+		was last seen on, until LINE_LOST_TIMEOUT expires. If it has not
+		been seen on either side yet, the robot sweeps right then left,
+		each sweep LINE_SWEEP_TIME longer than the one before, so it
+		ends up further out on each side in turn.
+
+		Lap timing: a start/finish bar across the track darkens all three
+		sensors at once. The time between two bars is one lap.
+*/
+
+// line follower states
+static const short LINE_STATE_TRACKING 	= 0;
+static const short LINE_STATE_SEARCHING = 1;
+static const short LINE_STATE_LOST 			= 2;
+
+//==========================================================
+//  LINE FOLLOWER STATE
+//==========================================================
+static short 	lineState 						= LINE_STATE_TRACKING;
+static int 		lineErrorLast 				= 0;
+static float 	lineErrorIntegral 		= 0.0;
+static int 		lineLastSeenSide 			= 0; // -1 left, 1 right, 0 not yet
+static long 	lineLostTime 					= 0;
+
+//==========================================================
+//  LINE FOLLOWER METRICS
+//==========================================================
+static long 	lineLapStartTime 			= 0;
+static long 	lineLapTimeLast 			= 0; // ms
+static long 	lineLapTimeBest 			= 0; // ms
+static short 	lineLapCount 					= 0;
+static bool 	bLineOnLapMarker 			= false;
+static float 	lineErrorSumSquares 	= 0.0;
+static long 	lineErrorSamples 			= 0;
+static int 		lineErrorMax 					= 0;
+
+// FUNCTION DECLARATIONS
+void 	lineFollowerReset();
+bool 	lineCentroid(int *position);
+short lineSweepSide(long elapsed);
+short lineFollowerStep();
+float lineCrossTrackRMS();
+void 	lineFollowerReport();
+
+//==========================================================
+//	lineFollowerReset
+//	Clear the controller and metrics before a new run
+//==========================================================
+void lineFollowerReset()
+{
+	lineState 					= LINE_STATE_TRACKING;
+	lineErrorLast 			= 0;
+	lineErrorIntegral 	= 0.0;
+	lineLastSeenSide 		= 0;
+	lineLostTime 				= nSysTime;
+
+	lineLapStartTime 		= 0;
+	lineLapTimeLast 		= 0;
+	lineLapTimeBest 		= 0;
+	lineLapCount 				= 0;
+	bLineOnLapMarker 		= false;
+	lineErrorSumSquares = 0.0;
+	lineErrorSamples 		= 0;
+	lineErrorMax 				= 0;
+} // end lineFollowerReset
+
+//==========================================================
+//	lineCentroid
+//	Weighted average of the sensor positions, using how much
+//	darker than LINE_DARK_THRESHOLD each sensor reads.
+//	Returns false if no sensor sees enough of the line.
+//	Uses the values sampled by monitorSensors, which reads the
+//	line sensors every few ms while in MODE_TRACKLINE.
+//   LIGHTER <- 0   SensorValue[lineFollowerN]   -> 4095  DARKER
+//==========================================================
+bool lineCentroid(int *position)
+{
+	int weightLeft 		= lineFollower1ValGlobal - LINE_DARK_THRESHOLD;
+	int weightMiddle 	= lineFollower2ValGlobal - LINE_DARK_THRESHOLD;
+	int weightRight 	= lineFollower3ValGlobal - LINE_DARK_THRESHOLD;
+
+	if( weightLeft < 0 )
+		weightLeft = 0;
+	if( weightMiddle < 0 )
+		weightMiddle = 0;
+	if( weightRight < 0 )
+		weightRight = 0;
+
+	int sumWeight = weightLeft + weightMiddle + weightRight;
+
+	// not enough dark under any sensor, line is lost
+	if( sumWeight < LINE_MIN_SIGNAL )
+		return false;
+
+	*position = ( (weightRight - weightLeft) * LINE_POSITION_SCALE ) / sumWeight;
+
+	return true;
+} // end lineCentroid
+
+//==========================================================
+//	lineSweepSide
+//	Side to strafe to, elapsed ms into a search for a line
+//	that was never seen: sweeps of 1, 2, 3 ... times
+//	LINE_SWEEP_TIME, right first. Returns -1 left, 1 right.
+//==========================================================
+short lineSweepSide(long elapsed)
+{
+	short sweep 		= 0;
+	long 	sweepEnd 	= LINE_SWEEP_TIME;
+
+	while( elapsed >= sweepEnd )
+	{
+		sweep += 1;
+		sweepEnd += (sweep + 1) * LINE_SWEEP_TIME;
+	}
+
+	if( sweep % 2 == 0 )
+		return 1;
+
+	return -1;
+} // end lineSweepSide
+
+//==========================================================
+//	lineFollowerStep
+//	Run one control period of the line follower.
+//	Call every LINE_CONTROL_PERIOD milliseconds.
+//	Returns the line follower state.
+//==========================================================
+short lineFollowerStep()
+{
+	int position = 0;
+	long now = nSysTime;
+
+	if( lineCentroid(&position) )
+	{
+		// lap marker: all three sensors dark at the same time
+		if( lineFollower1ValGlobal > LINE_DARK_THRESHOLD &&
+				lineFollower2ValGlobal > LINE_DARK_THRESHOLD &&
+				lineFollower3ValGlobal > LINE_DARK_THRESHOLD )
+		{
+			if( !bLineOnLapMarker &&
+					now - lineLapStartTime > LINE_LAP_DEBOUNCE )
+			{
+				if( lineLapStartTime != 0 )
+				{
+					lineLapTimeLast = now - lineLapStartTime;
+					lineLapCount += 1;
+					if( lineLapTimeBest == 0 || lineLapTimeLast < lineLapTimeBest )
+						lineLapTimeBest = lineLapTimeLast;
+					writeDebugStreamLine("lap %d: %d ms", lineLapCount, lineLapTimeLast);
+				}
+				lineLapStartTime = now;
+			}
+			bLineOnLapMarker = true;
+
+			// the marker carries no steering information,
+			// hold the last correction and keep going
+			position = lineErrorLast;
+		}
+		else
+		{
+			bLineOnLapMarker = false;
+		}
+
+		// positive error ... line is to the right of center
+		int error = position;
+
+		lineErrorIntegral += error;
+		if( lineErrorIntegral > LINE_INTEGRAL_LIMIT )
+			lineErrorIntegral = LINE_INTEGRAL_LIMIT;
+		else if( lineErrorIntegral < -LINE_INTEGRAL_LIMIT )
+			lineErrorIntegral = -LINE_INTEGRAL_LIMIT;
+
+		// on a state change the derivative would kick, so skip it once
+		int derivative = 0;
+		if( lineState == LINE_STATE_TRACKING )
+			derivative = error - lineErrorLast;
+
+		float strafe = LINE_KP * error
+									+ LINE_KI * lineErrorIntegral
+									+ LINE_KD * derivative;
+		float rotate = LINE_KYAW * error;
+
+		moveMecanumReact( LINE_SPEED_FORWARD, (int)strafe, (int)rotate );
+
+		// remember which side the line was on, for recovery
+		if( error > 0 )
+			lineLastSeenSide = 1;
+		else if( error < 0 )
+			lineLastSeenSide = -1;
+
+		// cross track error metrics
+		lineErrorSumSquares += (float)error * error;
+		lineErrorSamples += 1;
+		if( abs(error) > lineErrorMax )
+			lineErrorMax = abs(error);
+
+		lineErrorLast = error;
+		lineLostTime 	= now;
+		lineState 		= LINE_STATE_TRACKING;
+		return lineState;
+	}
+
+	// Line is lost.
+	// Search by strafing toward the side it was last seen on,
+	// or sweep both sides if it was never seen.
+	// Do not creep forward, the line may have turned sharply.
+	if( now - lineLostTime < LINE_LOST_TIMEOUT )
+	{
+		lineErrorIntegral = 0.0;
+
+		short side = lineLastSeenSide;
+		if( side == 0 )
+			side = lineSweepSide(now - lineLostTime);
+
+		if( side < 0 )
+			moveMecanumReact( 0, -LINE_SPEED_SEARCH, 0 );
+		else
+			moveMecanumReact( 0, LINE_SPEED_SEARCH, 0 );
+		lineState = LINE_STATE_SEARCHING;
+	}
+	else
+	{
+		if( lineState != LINE_STATE_LOST )
+			writeDebugStreamLine("lineFollowerStep line lost");
+		moveStopReact();
+		lineState = LINE_STATE_LOST;
+	}
+
+	return lineState;
+} // end lineFollowerStep
+
+//==========================================================
+//	lineCrossTrackRMS
+//	Root mean square cross track error in inches
+//==========================================================
+float lineCrossTrackRMS()
+{
+	if( lineErrorSamples == 0 )
+		return 0.0;
+
+	return sqrt( lineErrorSumSquares / lineErrorSamples )
+					* LINE_SENSOR_SPACING / LINE_POSITION_SCALE;
+} // end lineCrossTrackRMS
+
+//==========================================================
+//	lineFollowerReport
+//	Write the run metrics to the debug stream
+//==========================================================
+void lineFollowerReport()
+{
+	writeDebugStreamLine("laps: %d last: %d ms best: %d ms",
+												lineLapCount, lineLapTimeLast, lineLapTimeBest);
+	writeDebugStreamLine("cross track rms: %f in max: %f in",
+												lineCrossTrackRMS(),
+												lineErrorMax * LINE_SENSOR_SPACING / LINE_POSITION_SCALE);
+} // end lineFollowerReport
@@ -0,0 +1,171 @@
+/*
+		MapStore.h
+		Sparse long term map for mappingMode.
+
+		The dense occupancy grid (OccupancyGrid.h) only covers the area
+		around the robot. Cells that scroll out of it are kept here, at
+		2 bits per cell (MAP_STATE_XXX), in 8 x 8 cell tiles:
+			one tile 			= 8 rows of 8 cells = 8 shorts = 16 bytes
+			tile lookup 	= hash of the tile coordinates into mapTileHash,
+											open addressing with linear probing
+		A tile only exists once one of its cells is known, so unknown
+		space costs nothing.
+
+		Memory:
+			tiles		MAP_TILE_POOL * 16 bytes				2048
+			keys		MAP_TILE_POOL * 2 shorts					 512
+			hash		MAP_HASH_SIZE shorts								 512
+																			total		3072 bytes
+		for 128 tiles = 8192 cells. The dense grid needs one byte per
+		cell whether it is known or not, so the same 8192 cells would
+		take 8192 bytes there.
+
+		Lookup and update cost one hash plus a probe or two (the hash
+		table is never more than half full), then a shift and mask.
+
+		Only mapShift and mapGetState outside the window pay for a
+		lookup. A dense 2 bit grid is smaller for an area whose bounds
+		are known beforehand; the store needs no bounds and spends
+		nothing on space never seen.
+
+		When every tile is in use, new tiles are dropped and counted in
+		mapTileDropped.
+
+		mapStoreKnown counts the free and occupied cells stored. The
+		grid window clears the cells it loads back, so together with
+		the window this is the whole map.
+*/
+
+static short 	mapTileBits[MAP_TILE_POOL * MAP_TILE_SIZE];
+static short 	mapTileKeyX[MAP_TILE_POOL];
+static short 	mapTileKeyY[MAP_TILE_POOL];
+static short 	mapTileHash[MAP_HASH_SIZE];
+static short 	mapTileUsed 		= 0;
+static long 	mapTileDropped 	= 0;
+static int 		mapStoreKnown 	= 0;	// free or occupied cells stored
+
+// FUNCTION DECLARATIONS
+void 	mapStoreReset();
+int 	mapTileOf(int cell);
+short mapTileFind(int tileX, int tileY, bool bCreate);
+short mapStoreGet(int cellX, int cellY);
+void 	mapStoreSet(int cellX, int cellY, short state);
+
+//==========================================================
+//	mapStoreReset
+//	Forget every tile
+//==========================================================
+void mapStoreReset()
+{
+	for( int i = 0; i < MAP_HASH_SIZE; i++ )
+	{
+		mapTileHash[i] = MAP_HASH_EMPTY;
+	}
+
+	mapTileUsed 		= 0;
+	mapTileDropped 	= 0;
+	mapStoreKnown 	= 0;
+} // end mapStoreReset
+
+//==========================================================
+//	mapTileOf
+//	Tile number of a world cell number, rounding down for
+//	negative cells too
+//==========================================================
+int mapTileOf(int cell)
+{
+	if( cell >= 0 )
+		return cell / MAP_TILE_SIZE;
+
+	return -( (-cell - 1) / MAP_TILE_SIZE ) - 1;
+} // end mapTileOf
+
+//==========================================================
+//	mapTileFind
+//	Index of the tile in the pool, creating it (all unknown)
+//	if bCreate is true.
+//	Returns -1 if the tile does not exist or the pool is full.
+//==========================================================
+short mapTileFind(int tileX, int tileY, bool bCreate)
+{
+	int slot = ( tileX * 73 + tileY * 151 ) & (MAP_HASH_SIZE - 1);
+
+	while( mapTileHash[slot] != MAP_HASH_EMPTY )
+	{
+		short tile = mapTileHash[slot];
+		if( mapTileKeyX[tile] == tileX && mapTileKeyY[tile] == tileY )
+			return tile;
+		slot = (slot + 1) & (MAP_HASH_SIZE - 1);
+	}
+
+	if( !bCreate )
+		return -1;
+
+	if( mapTileUsed >= MAP_TILE_POOL )
+	{
+		mapTileDropped += 1;
+		return -1;
+	}
+
+	short newTile = mapTileUsed;
+	mapTileUsed += 1;
+
+	mapTileKeyX[newTile] = tileX;
+	mapTileKeyY[newTile] = tileY;
+	for( int row = 0; row < MAP_TILE_SIZE; row++ )
+	{
+		mapTileBits[newTile * MAP_TILE_SIZE + row] = 0;
+	}
+
+	mapTileHash[slot] = newTile;
+	return newTile;
+} // end mapTileFind
+
+//==========================================================
+//	mapStoreGet
+//	MAP_STATE_XXX of a world cell
+//==========================================================
+short mapStoreGet(int cellX, int cellY)
+{
+	int tileX = mapTileOf(cellX);
+	int tileY = mapTileOf(cellY);
+
+	short tile = mapTileFind(tileX, tileY, false);
+	if( tile < 0 )
+		return MAP_STATE_UNKNOWN;
+
+	int column 	= cellX - tileX * MAP_TILE_SIZE;
+	int row 		= cellY - tileY * MAP_TILE_SIZE;
+	int bits 		= mapTileBits[tile * MAP_TILE_SIZE + row];
+
+	return ( bits >> (column * 2) ) & 3;
+} // end mapStoreGet
+
+//==========================================================
+//	mapStoreSet
+//	Store the MAP_STATE_XXX of a world cell
+//==========================================================
+void mapStoreSet(int cellX, int cellY, short state)
+{
+	int tileX = mapTileOf(cellX);
+	int tileY = mapTileOf(cellY);
+
+	// do not create a tile just to say we know nothing
+	short tile = mapTileFind(tileX, tileY, state != MAP_STATE_UNKNOWN);
+	if( tile < 0 )
+		return;
+
+	int column 	= cellX - tileX * MAP_TILE_SIZE;
+	int row 		= cellY - tileY * MAP_TILE_SIZE;
+	int index 	= tile * MAP_TILE_SIZE + row;
+	int bits 		= mapTileBits[index] & 0xFFFF;
+	short old 	= ( bits >> (column * 2) ) & 3;
+
+	if( old == MAP_STATE_FREE || old == MAP_STATE_OCCUPIED )
+		mapStoreKnown -= 1;
+	if( state == MAP_STATE_FREE || state == MAP_STATE_OCCUPIED )
+		mapStoreKnown += 1;
+
+	bits = ( bits & ~(3 << (column * 2)) ) | ( state << (column * 2) );
+	mapTileBits[index] = bits;
+} // end mapStoreSet
@@ -0,0 +1,361 @@
+/*
+		MissionRunner.h
+		Non blocking interpreter for the mission bytecode in Missions.h.
+
+		missionStep runs once per MISSION_CONTROL_PERIOD tick and does
+		one step of the current instruction: a MOVE, ROTATE or WAIT goes
+		on over many ticks and returns right away, any other instruction
+		is done in the tick it is read. So the scheduler keeps the LCD
+		and the buttons going during a mission, and LOOP, NEXT and the
+		jumps cannot stall the robot. Nested LOOPs are kept on a fixed
+		stack of MISSION_LOOP_DEPTH.
+
+		MOVE drives through moveFieldReact toward the point dir and
+		inches away from where the MOVE started, holding the heading,
+		and slows down over the last inches. The heading held is the
+		goal of the last ROTATE, so turning errors do not add up.
+		A MOVE or ROTATE that takes longer than MISSION_STEP_TIMEOUT, or
+		a MOVE toward the front that hits something, fails the mission.
+
+		Interpreter overhead: nSysTime only counts milliseconds, much
+		more than one step takes, and the ticks start on a millisecond,
+		so timing each tick would read 0. Instead missionBenchmark times
+		MISSION_BENCHMARK_STEPS steps back to back of MISSION_BENCHMARK,
+		which runs the dispatch and the instructions that do not move
+		the robot for ever, before the mission starts, in a
+		SENTINAL_BENCHMARK build (DebugLog.h). missionReport gives the
+		result in microseconds per step, or n/a when it was not timed.
+*/
+
+static int 		missionPC 						= 0;	// byte of the current instruction
+static bool 	bMissionOpStarted 		= false;
+static short 	missionState 					= MISSION_DONE;
+static long 	missionOpStartTime 		= 0;
+
+// the current MOVE or ROTATE
+static float 	missionHeading 				= 90.0;	// held, the last ROTATE goal
+static float 	missionGoalX 					= 0.0;
+static float 	missionGoalY 					= 0.0;
+
+static int 		missionLoopPC[MISSION_LOOP_DEPTH];
+static short 	missionLoopCount[MISSION_LOOP_DEPTH];
+static short 	missionLoopDepth 			= 0;
+
+// interpreter metrics
+static long 	missionStartTime 			= 0;
+static long 	missionTicks 					= 0;
+static long 	missionInstructions 	= 0;
+static long 	missionStepTime 			= 0;	// us, see missionBenchmark
+
+// FUNCTION DECLARATIONS
+void 	missionStart(short mission);
+int 	missionArgSigned(int offset);
+bool 	missionMoveStep();
+bool 	missionRotateStep();
+bool 	missionSonarNear(short sonar, int inches);
+void 	missionFail(string reason);
+short missionStep();
+void 	missionBenchmark(int steps);
+void 	missionReport();
+
+//==========================================================
+//	missionStart
+//	Run mission MISSION_XXX from its first instruction
+//==========================================================
+void missionStart(short mission)
+{
+	writeDebugStreamLine("missionStart %d", mission);
+
+	odometryUpdate();
+
+	missionPC 					= missionEntry[mission];
+	missionHeading 			= odomHeading;
+	bMissionOpStarted 	= false;
+	missionLoopDepth 		= 0;
+	missionState 				= MISSION_RUNNING;
+
+	missionStartTime 		= nSysTime;
+	missionTicks 				= 0;
+	missionInstructions = 0;
+} // end missionStart
+
+//==========================================================
+//	missionArgSigned
+//	Argument byte offset bytes after the opcode, -128 .. 127
+//==========================================================
+int missionArgSigned(int offset)
+{
+	int value = missionCode[missionPC + offset];
+	if( value > 127 )
+		value -= 256;
+
+	return value;
+} // end missionArgSigned
+
+//==========================================================
+//	missionMoveStep
+//	One tick of a MOVE, true once the goal is reached
+//==========================================================
+bool missionMoveStep()
+{
+	if( !bMissionOpStarted )
+	{
+		// dir is counted from the right of the robot, like DIRECTION_XXX
+		float direction = missionHeading + missionCode[missionPC + 1] * 45.0 - DIRECTION_FRONT;
+		float distance 	= missionCode[missionPC + 2];
+
+		missionGoalX 		= odomX + distance * cos( degreesToRadians(direction) );
+		missionGoalY 		= odomY + distance * sin( degreesToRadians(direction) );
+		bMissionOpStarted = true;
+	}
+
+	float dx = missionGoalX - odomX;
+	float dy = missionGoalY - odomY;
+	float togo = sqrt(dx * dx + dy * dy);
+
+	if( togo < MISSION_MOVE_TOLERANCE )
+	{
+		moveStopReact();
+		return true;
+	}
+
+	float speed = MISSION_SPEED_KP * togo;
+	if( speed > missionCode[missionPC + 3] )
+		speed = missionCode[missionPC + 3];
+	if( speed < MISSION_SPEED_MIN )
+		speed = MISSION_SPEED_MIN;
+
+	moveFieldReact( speed * dx / togo, speed * dy / togo, missionHeading );
+	return false;
+} // end missionMoveStep
+
+//==========================================================
+//	missionRotateStep
+//	One tick of a ROTATE, true once the heading is reached
+//==========================================================
+bool missionRotateStep()
+{
+	if( !bMissionOpStarted )
+	{
+		missionHeading 		= missionHeading + missionArgSigned(1) * 2.0;
+		bMissionOpStarted = true;
+	}
+
+	float error = angleDifference(odomHeading, missionHeading);
+	if( abs(error) < MISSION_TURN_TOLERANCE )
+	{
+		moveStopReact();
+		return true;
+	}
+
+	// turned counter clockwise of the goal: turn clockwise
+	float rotate 	= MOVEMENT_HEADING_KP * error;
+	short speed 	= missionCode[missionPC + 2];
+	if( rotate > speed )
+		rotate = speed;
+	else if( rotate < -speed )
+		rotate = -speed;
+	else if( rotate > 0.0 && rotate < MISSION_TURN_SPEED_MIN )
+		rotate = MISSION_TURN_SPEED_MIN;
+	else if( rotate < 0.0 && rotate > -MISSION_TURN_SPEED_MIN )
+		rotate = -MISSION_TURN_SPEED_MIN;
+
+	moveMecanumReact( 0, 0, (int)rotate );
+	return false;
+} // end missionRotateStep
+
+//==========================================================
+//	missionSonarNear
+//	true if the sonar sees something nearer than inches
+//==========================================================
+bool missionSonarNear(short sonar, int inches)
+{
+	return bSonarTracking[sonar] && sonarRangeGlobal[sonar] < inches;
+} // end missionSonarNear
+
+//==========================================================
+//	missionFail
+//	Stop the robot and end the mission
+//==========================================================
+void missionFail(string reason)
+{
+	moveStopReact();
+	writeDebugStreamLine("mission failed at %d: %s", missionPC, reason);
+	missionState = MISSION_FAILED;
+} // end missionFail
+
+//==========================================================
+//	missionStep
+//	One tick of the interpreter, every MISSION_CONTROL_PERIOD.
+//	Returns the mission state.
+//==========================================================
+short missionStep()
+{
+	if( missionState != MISSION_RUNNING )
+	{
+		moveStopReact();
+		return missionState;
+	}
+
+	ubyte op 				= missionCode[missionPC];
+	int 	length 		= 1;		// bytes of the instruction
+	bool 	bDone 		= true;		// go on to the next instruction
+	int 	jump 			= 0;
+
+	if( !bMissionOpStarted )
+	{
+		missionOpStartTime 	= nSysTime;
+		missionInstructions += 1;
+	}
+
+	switch(op)
+	{
+		case MISSION_OP_MOVE:
+			length = 4;
+			// dir 1 .. 3 heads into the front bumper
+			if( missionCode[missionPC + 1] >= 1 && missionCode[missionPC + 1] <= 3 &&
+					collisionDetected() )
+			{
+				missionFail("collision");
+				return missionState;
+			}
+			bDone = missionMoveStep();
+			break;
+
+		case MISSION_OP_ROTATE:
+			length 	= 3;
+			bDone 	= missionRotateStep();
+			break;
+
+		case MISSION_OP_WAIT:
+			length 	= 2;
+			moveStopReact();
+			bMissionOpStarted = true;
+			bDone 	= ( nSysTime - missionOpStartTime >= missionCode[missionPC + 1] * 100 );
+			break;
+
+		case MISSION_OP_WAIT_SONAR:
+			length = 4;
+			moveStopReact();
+			bMissionOpStarted = true;
+			bDone = missionSonarNear( missionCode[missionPC + 1], missionCode[missionPC + 3] );
+			if( missionCode[missionPC + 2] != 0 )
+				bDone = !bDone;
+			break;
+
+		case MISSION_OP_WAIT_BUMPER:
+			moveStopReact();
+			bMissionOpStarted = true;
+			bDone = bFrontBumperPressed;
+			break;
+
+		case MISSION_OP_LOOP:
+			length = 2;
+			if( missionLoopDepth >= MISSION_LOOP_DEPTH )
+			{
+				missionFail("loops nested too deep");
+				return missionState;
+			}
+			missionLoopPC[missionLoopDepth] 		= missionPC + length;
+			missionLoopCount[missionLoopDepth] 	= missionCode[missionPC + 1];
+			missionLoopDepth += 1;
+			break;
+
+		case MISSION_OP_NEXT:
+			if( missionLoopDepth == 0 )
+			{
+				missionFail("NEXT without LOOP");
+				return missionState;
+			}
+			// a count of 0 loops for ever
+			if( missionLoopCount[missionLoopDepth - 1] != 1 )
+			{
+				if( missionLoopCount[missionLoopDepth - 1] > 1 )
+					missionLoopCount[missionLoopDepth - 1] -= 1;
+				jump = missionLoopPC[missionLoopDepth - 1] - (missionPC + length);
+			}
+			else
+			{
+				missionLoopDepth -= 1;
+			}
+			break;
+
+		case MISSION_OP_IF_SONAR:
+			length = 4;
+			if( missionSonarNear( missionCode[missionPC + 1], missionCode[missionPC + 2] ) )
+				jump = missionArgSigned(3);
+			break;
+
+		case MISSION_OP_JUMP:
+			length 	= 2;
+			jump 		= missionArgSigned(1);
+			break;
+
+		case MISSION_OP_END:
+			moveStopReact();
+			missionState = MISSION_DONE;
+			missionReport();
+			return missionState;
+
+		default:
+			missionFail("unknown opcode");
+			return missionState;
+	} // end switch
+
+	if( bDone )
+	{
+		missionPC 				+= length + jump;
+		bMissionOpStarted = false;
+	}
+	else if( ( op == MISSION_OP_MOVE || op == MISSION_OP_ROTATE ) &&
+						nSysTime - missionOpStartTime > MISSION_STEP_TIMEOUT )
+	{
+		missionFail("timeout");
+		return missionState;
+	}
+
+	missionTicks += 1;
+	return missionState;
+} // end missionStep
+
+//==========================================================
+//	missionBenchmark
+//	Time steps back to back of MISSION_BENCHMARK into
+//	missionStepTime. The robot stands still, call it before
+//	missionStart.
+//==========================================================
+void missionBenchmark(int steps)
+{
+	long start 		= 0;
+	long elapsed 	= 0;
+
+	missionStart(MISSION_BENCHMARK);
+
+	start = nSysTime;
+	for( int i = 0; i < steps; i++ )
+		missionStep();
+	elapsed = nSysTime - start;
+
+	missionStepTime = elapsed * 1000 / steps;
+	missionState 		= MISSION_DONE;
+
+	writeDebugStreamLine("mission step: %d us (%d steps in %d ms)",
+												missionStepTime, steps, elapsed);
+} // end missionBenchmark
+
+//==========================================================
+//	missionReport
+//	Write the run time and the interpreter overhead to the
+//	debug stream, n/a when missionBenchmark did not run
+//==========================================================
+void missionReport()
+{
+	if( missionStepTime == 0 )
+		writeDebugStreamLine("mission: %d ms, %d instructions in %d ticks, n/a us/step",
+													nSysTime - missionStartTime, missionInstructions,
+													missionTicks);
+	else
+		writeDebugStreamLine("mission: %d ms, %d instructions in %d ticks, %d us/step",
+													nSysTime - missionStartTime, missionInstructions,
+													missionTicks, missionStepTime);
+} // end missionReport
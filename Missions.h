@@ -0,0 +1,80 @@
+/*
+		Missions.h
+		The autonomous routines for missionMode, as bytecode run by
+		MissionRunner.h. Changing a routine only means changing the
+		bytes below, no C code.
+
+		Instruction set, one opcode byte then its argument bytes:
+			END																	stop, the mission is done
+			MOVE				dir inches speed				drive inches in direction dir,
+																						DIRECTION_XXX / 45 relative to
+																						the robot (2 = front, 0 = right)
+			ROTATE			twoDegrees speed				turn in place by twoDegrees * 2
+																						degrees, signed, + counter
+																						clockwise
+			WAIT				tenths									stop for tenths of a second
+			WAIT_SONAR	sonar compare inches		stop until sonar SONAR_XXX sees
+																						something nearer (compare 0) or
+																						nothing nearer (compare 1) than
+																						inches
+			WAIT_BUMPER													stop until the front bumper is hit
+			LOOP				count										run up to the matching NEXT count
+																						times, 0 for ever
+			NEXT																end of a LOOP
+			IF_SONAR		sonar inches offset			jump offset bytes (signed) if sonar
+																						sees something nearer than inches
+			JUMP				offset									jump offset bytes (signed)
+		Jump offsets count from the instruction after the jump.
+
+		Every mission starts at missionEntry[MISSION_XXX] in missionCode.
+*/
+
+static const ubyte MISSION_OP_END 					= 0;
+static const ubyte MISSION_OP_MOVE 					= 1;
+static const ubyte MISSION_OP_ROTATE 				= 2;
+static const ubyte MISSION_OP_WAIT 					= 3;
+static const ubyte MISSION_OP_WAIT_SONAR 		= 4;
+static const ubyte MISSION_OP_WAIT_BUMPER 	= 5;
+static const ubyte MISSION_OP_LOOP 					= 6;
+static const ubyte MISSION_OP_NEXT 					= 7;
+static const ubyte MISSION_OP_IF_SONAR 			= 8;
+static const ubyte MISSION_OP_JUMP 					= 9;
+
+static const short MISSION_DRIVE_TEST 	= 0;
+static const short MISSION_PATROL 			= 1;
+static const short MISSION_BENCHMARK 		= 2;	// not in the menu, see missionBenchmark
+static const short MISSION_COUNT 				= 3;
+
+static short missionSelected = MISSION_DRIVE_TEST;
+
+static const int missionEntry[MISSION_COUNT] = { 0, 23, 42 };
+
+static const ubyte missionCode[] =
+{
+	// MISSION_DRIVE_TEST, runDrivingTestBasic at speed 40 over 12 inches
+	MISSION_OP_MOVE, 				2, 12, 40,		// forward
+	MISSION_OP_WAIT, 				20,
+	MISSION_OP_MOVE, 				6, 12, 40,		// backward
+	MISSION_OP_WAIT, 				20,
+	MISSION_OP_MOVE, 				0, 12, 40,		// traverse right
+	MISSION_OP_WAIT, 				20,
+	MISSION_OP_MOVE, 				4, 12, 40,		// traverse left
+	MISSION_OP_END,
+
+	// MISSION_PATROL, a square, skipping the sides that are blocked
+	MISSION_OP_LOOP, 				4,
+	MISSION_OP_IF_SONAR, 		0, 18, 4,			// SONAR_FRONT, skip the MOVE
+	MISSION_OP_MOVE, 				2, 24, 40,
+	MISSION_OP_ROTATE, 			211, 30,			// -45: 90 degrees clockwise
+	MISSION_OP_NEXT,
+	MISSION_OP_WAIT_SONAR, 	0, 0, 12,			// wave in front of it to finish
+	MISSION_OP_END,
+
+	// MISSION_BENCHMARK, never moves and never ends
+	MISSION_OP_LOOP, 				0,
+	MISSION_OP_IF_SONAR, 		0, 0, 0,			// nothing is nearer than 0
+	MISSION_OP_WAIT, 				0,
+	MISSION_OP_JUMP, 				0,
+	MISSION_OP_NEXT,
+	MISSION_OP_END
+};
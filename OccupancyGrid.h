@@ -0,0 +1,459 @@
+/*
+		OccupancyGrid.h
+		Log-odds occupancy grid built from the four sonars at the
+		odometry pose (see Odometry.h).
+
+		Each cell is one signed byte of log-odds:
+			0 						... unknown
+			> MAP_LOG_OCCUPIED	... occupied
+			< MAP_LOG_FREE			... free
+
+		The grid is a MAP_SIZE x MAP_SIZE window of world cells. When
+		the robot gets within MAP_SCROLL_MARGIN cells of an edge, the
+		window scrolls MAP_SCROLL_STEP cells so the robot is back inside.
+		Cells that scroll out are saved to the sparse map store
+		(MapStore.h) as 2 bit states, and cells that scroll in are
+		loaded back from it, and cleared there: a cell is either in the
+		window or in the store. mapGetState answers for any world cell,
+		inside the window or not.
+
+		Sonar beam (cone model): MAP_CONE_RAYS rays spread over
+		+/- MAP_CONE_HALF_ANGLE. Every cell a ray crosses before the echo
+		gets MAP_LOG_MISS, the cell at the echo gets MAP_LOG_HIT.
+		A cell crossed by several rays of the same beam is only
+		updated once.
+
+		Every cell that becomes or stops being occupied is put on the
+		change queue, so the path planner can repair its plan instead
+		of planning again from scratch (see PathPlanner.h).
+
+		mapUpdateStep is incremental: each call only adds the sonar
+		samples that arrived since the last call.
+
+		Memory: MAP_SIZE * MAP_SIZE bytes = 1600 bytes, plus the ray
+		buffer of MAP_RAY_STEPS_MAX shorts.
+
+		A beam is at most MAP_CONE_RAYS * MAP_RAY_STEPS_MAX cell updates,
+		and each sonar gives one every SONAR_ECHO_PERIOD.
+*/
+
+static char 	mapCells[MAP_SIZE * MAP_SIZE];	// signed 8 bit log-odds
+static int 		mapOriginX 						= 0;	// world cell of mapCells column 0
+static int 		mapOriginY 						= 0;	// world cell of mapCells row 0
+static long 	mapBeamCount 					= 0;
+static long 	mapSampleCountLast[SONAR_COUNT];
+static short 	mapRayLast[MAP_RAY_STEPS_MAX];	// cells of the previous ray
+
+// cells whose occupancy changed, for the path planner
+static int 		mapChangeX[MAP_CHANGE_QUEUE];
+static int 		mapChangeY[MAP_CHANGE_QUEUE];
+static short 	mapChangeHead 				= 0;
+static short 	mapChangeTail 				= 0;
+static bool 	bMapChangeOverflow 		= false;
+static bool 	bMapStarted 					= false;
+
+// FUNCTION DECLARATIONS
+void 	mapReset();
+void 	mapStart();
+short mapStateOfLogOdds(int logOdds);
+int 	mapLogOddsOfState(short state);
+short mapGetState(int cellX, int cellY);
+int 	mapWorldToCell(float inches);
+short mapCellIndex(int cellX, int cellY);
+int 	mapGetLogOdds(int cellX, int cellY);
+void 	mapAddLogOdds(short index, short delta);
+void 	mapChanged(short index);
+bool 	mapNextChange(int *cellX, int *cellY);
+void 	mapShift(int shiftX, int shiftY);
+void 	mapScrollToRobot();
+void 	mapUpdateBeam(float x, float y, float angle, int range);
+void 	mapUpdateStep();
+int 	mapKnownCells();
+long 	mapKnownCellsAll();
+
+//==========================================================
+//	mapReset
+//	Forget the map and center the window on the robot
+//==========================================================
+void mapReset()
+{
+	mapStoreReset();
+
+	for( int i = 0; i < MAP_SIZE * MAP_SIZE; i++ )
+	{
+		mapCells[i] = 0;
+	}
+
+	mapChangeHead 			= 0;
+	mapChangeTail 			= 0;
+	bMapChangeOverflow 	= true;
+
+	mapOriginX 		= mapWorldToCell(odomX) - MAP_SIZE / 2;
+	mapOriginY 		= mapWorldToCell(odomY) - MAP_SIZE / 2;
+	mapBeamCount 	= 0;
+
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		mapSampleCountLast[i] = sonarSampleCount[i];
+	}
+
+	bMapStarted = true;
+} // end mapReset
+
+//==========================================================
+//	mapStart
+//	Empty map the first time a mode needs one, after that
+//	every mode keeps adding to the same map
+//==========================================================
+void mapStart()
+{
+	if( !bMapStarted )
+		mapReset();
+} // end mapStart
+
+//==========================================================
+//	mapStateOfLogOdds
+//	MAP_STATE_XXX for a log-odds value
+//==========================================================
+short mapStateOfLogOdds(int logOdds)
+{
+	if( logOdds > MAP_LOG_OCCUPIED )
+		return MAP_STATE_OCCUPIED;
+	if( logOdds < MAP_LOG_FREE )
+		return MAP_STATE_FREE;
+	if( logOdds != 0 )
+		return MAP_STATE_UNSURE;
+
+	return MAP_STATE_UNKNOWN;
+} // end mapStateOfLogOdds
+
+//==========================================================
+//	mapLogOddsOfState
+//	Log-odds to start a cell at when it is loaded back
+//	from the map store
+//==========================================================
+int mapLogOddsOfState(short state)
+{
+	if( state == MAP_STATE_OCCUPIED )
+		return MAP_LOG_OCCUPIED + 10;
+	if( state == MAP_STATE_FREE )
+		return MAP_LOG_FREE - 10;
+
+	return 0;
+} // end mapLogOddsOfState
+
+//==========================================================
+//	mapGetState
+//	MAP_STATE_XXX of any world cell, from the grid window
+//	if the cell is inside it, otherwise from the map store
+//==========================================================
+short mapGetState(int cellX, int cellY)
+{
+	short index = mapCellIndex(cellX, cellY);
+	if( index < 0 )
+		return mapStoreGet(cellX, cellY);
+
+	return mapStateOfLogOdds( mapCells[index] );
+} // end mapGetState
+
+//==========================================================
+//	mapWorldToCell
+//	World cell number of a coordinate in inches
+//==========================================================
+int mapWorldToCell(float inches)
+{
+	return (int)floor( inches / MAP_CELL_SIZE );
+} // end mapWorldToCell
+
+//==========================================================
+//	mapCellIndex
+//	Index into mapCells of a world cell,
+//	-1 if the cell is outside the window
+//==========================================================
+short mapCellIndex(int cellX, int cellY)
+{
+	int gridX = cellX - mapOriginX;
+	int gridY = cellY - mapOriginY;
+
+	if( gridX < 0 || gridX >= MAP_SIZE ||
+			gridY < 0 || gridY >= MAP_SIZE )
+		return -1;
+
+	return gridY * MAP_SIZE + gridX;
+} // end mapCellIndex
+
+//==========================================================
+//	mapGetLogOdds
+//	Log-odds of a world cell, 0 (unknown) outside the window
+//==========================================================
+int mapGetLogOdds(int cellX, int cellY)
+{
+	short index = mapCellIndex(cellX, cellY);
+	if( index < 0 )
+		return 0;
+
+	return mapCells[index];
+} // end mapGetLogOdds
+
+//==========================================================
+//	mapAddLogOdds
+//	Add evidence to a cell, clamped so the cell can still
+//	change its mind later
+//==========================================================
+void mapAddLogOdds(short index, short delta)
+{
+	int before = mapCells[index];
+	int value = before + delta;
+
+	if( value > MAP_LOG_MAX )
+		value = MAP_LOG_MAX;
+	else if( value < MAP_LOG_MIN )
+		value = MAP_LOG_MIN;
+
+	mapCells[index] = value;
+
+	if( (before > MAP_LOG_OCCUPIED) != (value > MAP_LOG_OCCUPIED) )
+		mapChanged(index);
+} // end mapAddLogOdds
+
+//==========================================================
+//	mapChanged
+//	Queue a cell that became or stopped being occupied.
+//	If the queue is full, bMapChangeOverflow tells the
+//	reader to recheck everything.
+//==========================================================
+void mapChanged(short index)
+{
+	short next = (mapChangeHead + 1) % MAP_CHANGE_QUEUE;
+	if( next == mapChangeTail )
+	{
+		bMapChangeOverflow = true;
+		return;
+	}
+
+	mapChangeX[mapChangeHead] = mapOriginX + index % MAP_SIZE;
+	mapChangeY[mapChangeHead] = mapOriginY + index / MAP_SIZE;
+	mapChangeHead = next;
+} // end mapChanged
+
+//==========================================================
+//	mapNextChange
+//	Take the oldest changed cell off the queue.
+//	Returns false when the queue is empty.
+//==========================================================
+bool mapNextChange(int *cellX, int *cellY)
+{
+	if( mapChangeTail == mapChangeHead )
+		return false;
+
+	*cellX = mapChangeX[mapChangeTail];
+	*cellY = mapChangeY[mapChangeTail];
+	mapChangeTail = (mapChangeTail + 1) % MAP_CHANGE_QUEUE;
+	return true;
+} // end mapNextChange
+
+//==========================================================
+//	mapShift
+//	Move the window shiftX, shiftY cells in the world.
+//	Cells that stay inside the window are kept, cells that
+//	leave it are saved to the map store, and new cells are
+//	loaded from the map store.
+//==========================================================
+void mapShift(int shiftX, int shiftY)
+{
+	writeDebugStreamLine("mapShift %d %d", shiftX, shiftY);
+
+	// save the cells about to leave the window
+	for( int gridY = 0; gridY < MAP_SIZE; gridY++ )
+	{
+		for( int gridX = 0; gridX < MAP_SIZE; gridX++ )
+		{
+			int toX = gridX - shiftX;
+			int toY = gridY - shiftY;
+
+			if( toX < 0 || toX >= MAP_SIZE ||
+					toY < 0 || toY >= MAP_SIZE )
+				mapStoreSet( mapOriginX + gridX, mapOriginY + gridY,
+										 mapStateOfLogOdds( mapCells[gridY * MAP_SIZE + gridX] ) );
+		}
+	}
+
+	// walk in the direction that never overwrites a cell
+	// before it has been copied
+	int startX 	= 0;
+	int endX 		= MAP_SIZE;
+	int stepX 	= 1;
+	if( shiftX < 0 )
+	{
+		startX 	= MAP_SIZE - 1;
+		endX 		= -1;
+		stepX 	= -1;
+	}
+
+	int startY 	= 0;
+	int endY 		= MAP_SIZE;
+	int stepY 	= 1;
+	if( shiftY < 0 )
+	{
+		startY 	= MAP_SIZE - 1;
+		endY 		= -1;
+		stepY 	= -1;
+	}
+
+	for( int gridY = startY; gridY != endY; gridY += stepY )
+	{
+		for( int gridX = startX; gridX != endX; gridX += stepX )
+		{
+			int fromX = gridX + shiftX;
+			int fromY = gridY + shiftY;
+
+			if( fromX >= 0 && fromX < MAP_SIZE &&
+					fromY >= 0 && fromY < MAP_SIZE )
+			{
+				mapCells[gridY * MAP_SIZE + gridX] = mapCells[fromY * MAP_SIZE + fromX];
+			}
+			else
+			{
+				int worldX = mapOriginX + shiftX + gridX;
+				int worldY = mapOriginY + shiftY + gridY;
+
+				mapCells[gridY * MAP_SIZE + gridX] =
+					mapLogOddsOfState( mapStoreGet(worldX, worldY) );
+				mapStoreSet(worldX, worldY, MAP_STATE_UNKNOWN);
+			}
+		}
+	}
+
+	mapOriginX += shiftX;
+	mapOriginY += shiftY;
+} // end mapShift
+
+//==========================================================
+//	mapScrollToRobot
+//	Scroll the window if the robot is near its edge
+//==========================================================
+void mapScrollToRobot()
+{
+	int gridX = mapWorldToCell(odomX) - mapOriginX;
+	int gridY = mapWorldToCell(odomY) - mapOriginY;
+	int shiftX = 0;
+	int shiftY = 0;
+
+	// scroll in whole steps until the robot is inside the margin
+	while( gridX - shiftX < MAP_SCROLL_MARGIN )
+		shiftX -= MAP_SCROLL_STEP;
+	while( gridX - shiftX >= MAP_SIZE - MAP_SCROLL_MARGIN )
+		shiftX += MAP_SCROLL_STEP;
+	while( gridY - shiftY < MAP_SCROLL_MARGIN )
+		shiftY -= MAP_SCROLL_STEP;
+	while( gridY - shiftY >= MAP_SIZE - MAP_SCROLL_MARGIN )
+		shiftY += MAP_SCROLL_STEP;
+
+	if( shiftX != 0 || shiftY != 0 )
+		mapShift(shiftX, shiftY);
+} // end mapScrollToRobot
+
+//==========================================================
+//	mapUpdateBeam
+//	Add one sonar beam to the grid.
+//		x, y	... sonar position, inches
+//		angle	... beam direction, degrees (world frame)
+//		range	... echo range in inches, -1 for no echo
+//==========================================================
+void mapUpdateBeam(float x, float y, float angle, int range)
+{
+	bool bHit = true;
+	float length = range;
+
+	// no echo, or beyond what we trust: clear the near part only
+	if( range < 0 || range > MAP_FREE_RANGE_MAX )
+	{
+		bHit = false;
+		length = MAP_FREE_RANGE_MAX;
+	}
+
+	int steps = (int)( length / MAP_CELL_SIZE );
+	if( steps >= MAP_RAY_STEPS_MAX )
+		steps = MAP_RAY_STEPS_MAX - 1;
+
+	for( int i = 0; i < MAP_RAY_STEPS_MAX; i++ )
+	{
+		mapRayLast[i] = -1;
+	}
+
+	for( int ray = 0; ray < MAP_CONE_RAYS; ray++ )
+	{
+		float rayAngle = angle - MAP_CONE_HALF_ANGLE
+										+ ray * ( 2.0 * MAP_CONE_HALF_ANGLE / (MAP_CONE_RAYS - 1) );
+		float dx = cos( degreesToRadians(rayAngle) ) * MAP_CELL_SIZE;
+		float dy = sin( degreesToRadians(rayAngle) ) * MAP_CELL_SIZE;
+
+		for( int step = 0; step <= steps; step++ )
+		{
+			short index = mapCellIndex( mapWorldToCell(x + dx * step),
+																	mapWorldToCell(y + dy * step) );
+
+			// the rays of one beam overlap near the sonar,
+			// count each cell once
+			if( index < 0 || index == mapRayLast[step] )
+				continue;
+			mapRayLast[step] = index;
+
+			if( step == steps && bHit )
+				mapAddLogOdds(index, MAP_LOG_HIT);
+			else
+				mapAddLogOdds(index, MAP_LOG_MISS);
+		}
+	}
+
+	mapBeamCount += 1;
+} // end mapUpdateBeam
+
+//==========================================================
+//	mapUpdateStep
+//	Add every sonar sample that arrived since the last call.
+//	Call once per sensor tick.
+//==========================================================
+void mapUpdateStep()
+{
+	odometryUpdate();
+	mapScrollToRobot();
+
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		if( sonarSampleCount[i] == mapSampleCountLast[i] )
+			continue;
+		mapSampleCountLast[i] = sonarSampleCount[i];
+
+		mapUpdateBeam( odomX, odomY,
+									 odomHeading + SCAN_SONAR_OFFSET[i],
+									 sonarRawGlobal[i] );
+	}
+} // end mapUpdateStep
+
+//==========================================================
+//	mapKnownCells
+//	Number of cells in the window that are free or occupied
+//==========================================================
+int mapKnownCells()
+{
+	int known = 0;
+
+	for( int i = 0; i < MAP_SIZE * MAP_SIZE; i++ )
+	{
+		if( mapCells[i] > MAP_LOG_OCCUPIED || mapCells[i] < MAP_LOG_FREE )
+			known++;
+	}
+
+	return known;
+} // end mapKnownCells
+
+//==========================================================
+//	mapKnownCellsAll
+//	Number of cells that are free or occupied, in the window
+//	and in the map store
+//==========================================================
+long mapKnownCellsAll()
+{
+	return mapKnownCells() + mapStoreKnown;
+} // end mapKnownCellsAll
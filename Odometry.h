@@ -0,0 +1,139 @@
+/*
+		Odometry.h
+		Dead reckoning of the robot pose from the four motor IECs.
+
+		World frame, fixed where the program started:
+			odomX				... inches, to the right of the start position
+			odomY				... inches, ahead of the start position
+			odomHeading	... degrees, counter clockwise from the x axis,
+											same convention as the DIRECTION_XXX values.
+											Starts at DIRECTION_FRONT (90).
+
+		Mecanum forward kinematics, wheel travel in inches:
+			forward	= ( LF + LR + RF + RR ) / 4
+			strafe	= ( LF - LR - RF + RR ) / 4 * MOVEMENT_LATERAL_ADJUSTER
+			rotate	= ( LF + LR - RF - RR ) / 4 / MOVEMENT_ROTATE_ADJUSTER
+								(radians, clockwise)
+
+		The moveXXX functions reset the IECs all the time.
+		resetMotorEncoders folds the counts into the pose before it
+		clears them, so no travel is lost.
+*/
+
+static float 	odomX 				= 0.0;
+static float 	odomY 				= 0.0;
+static float 	odomHeading 	= 90.0;
+static long 	odomEncoderLast[4]; // RF, LF, RR, LR
+static float 	odomWheelTravel[4]; // inches each wheel turned, never reset
+
+// FUNCTION DECLARATIONS
+void 	odometryReset();
+void 	odometryIntegrate();
+void 	odometryUpdate();
+void 	odometryClearEncoders();
+float angleDifference(float toHeading, float fromHeading);
+
+//====================================================================
+//	odometryReset
+//	Put the robot back at the origin, facing DIRECTION_FRONT
+//====================================================================
+void odometryReset()
+{
+	hogCPU();
+	odomX 			= 0.0;
+	odomY 			= 0.0;
+	odomHeading = DIRECTION_FRONT;
+	odomEncoderLast[0] = getMotorEncoder(motor_RF);
+	odomEncoderLast[1] = getMotorEncoder(motor_LF);
+	odomEncoderLast[2] = getMotorEncoder(motor_RR);
+	odomEncoderLast[3] = getMotorEncoder(motor_LR);
+	releaseCPU();
+} // end odometryReset
+
+//====================================================================
+//	odometryIntegrate
+//	Add the wheel travel since the last call to the pose.
+//	Caller must hold the CPU (hogCPU), see odometryUpdate.
+//====================================================================
+void odometryIntegrate()
+{
+	long encoderRF = getMotorEncoder(motor_RF);
+	long encoderLF = getMotorEncoder(motor_LF);
+	long encoderRR = getMotorEncoder(motor_RR);
+	long encoderLR = getMotorEncoder(motor_LR);
+
+	float travelRF = (encoderRF - odomEncoderLast[0]) / MOVEMENT_LINEAR_ADJUSTER;
+	float travelLF = (encoderLF - odomEncoderLast[1]) / MOVEMENT_LINEAR_ADJUSTER;
+	float travelRR = (encoderRR - odomEncoderLast[2]) / MOVEMENT_LINEAR_ADJUSTER;
+	float travelLR = (encoderLR - odomEncoderLast[3]) / MOVEMENT_LINEAR_ADJUSTER;
+
+	odomEncoderLast[0] = encoderRF;
+	odomEncoderLast[1] = encoderLF;
+	odomEncoderLast[2] = encoderRR;
+	odomEncoderLast[3] = encoderLR;
+
+	// for the wheel speeds in Telemetry.h
+	odomWheelTravel[0] += travelRF;
+	odomWheelTravel[1] += travelLF;
+	odomWheelTravel[2] += travelRR;
+	odomWheelTravel[3] += travelLR;
+
+	float forward = ( travelLF + travelLR + travelRF + travelRR ) / 4.0;
+	float strafe 	= ( travelLF - travelLR - travelRF + travelRR ) / 4.0
+									* MOVEMENT_LATERAL_ADJUSTER;
+	float rotate 	= ( travelLF + travelLR - travelRF - travelRR ) / 4.0
+									/ MOVEMENT_ROTATE_ADJUSTER;
+
+	// translate along the heading half way through the rotation
+	float headingMid = degreesToRadians(odomHeading) - rotate / 2.0;
+
+	odomX += forward * cos(headingMid) + strafe * sin(headingMid);
+	odomY += forward * sin(headingMid) - strafe * cos(headingMid);
+
+	// clockwise rotation lowers the heading
+	odomHeading -= radiansToDegrees(rotate);
+	while( odomHeading >= 360.0 )
+		odomHeading -= 360.0;
+	while( odomHeading < 0.0 )
+		odomHeading += 360.0;
+} // end odometryIntegrate
+
+//====================================================================
+//	odometryUpdate
+//	Bring the pose up to date. Safe to call from any task.
+//====================================================================
+void odometryUpdate()
+{
+	hogCPU();
+	odometryIntegrate();
+	releaseCPU();
+} // end odometryUpdate
+
+//====================================================================
+//	odometryClearEncoders
+//	Called by resetMotorEncoders after the IECs are cleared.
+//====================================================================
+void odometryClearEncoders()
+{
+	odomEncoderLast[0] = 0;
+	odomEncoderLast[1] = 0;
+	odomEncoderLast[2] = 0;
+	odomEncoderLast[3] = 0;
+} // end odometryClearEncoders
+
+//====================================================================
+//	angleDifference
+//	Signed difference between two headings in degrees,
+//	-180 .. 180. Positive is counter clockwise.
+//====================================================================
+float angleDifference(float toHeading, float fromHeading)
+{
+	float difference = toHeading - fromHeading;
+
+	while( difference > 180.0 )
+		difference -= 360.0;
+	while( difference <= -180.0 )
+		difference += 360.0;
+
+	return difference;
+} // end angleDifference
@@ -0,0 +1,404 @@
+/*
+		PathFollower.h
+		Pure pursuit path following for the mecanum drive.
+
+		The path is a polyline of waypoints in the world frame of
+		Odometry.h, each with the heading the robot should have there.
+		Every tick the robot is projected onto the path, and the target
+		is the point PURSUIT_LOOKAHEAD inches further along it. The robot
+		translates straight at that target with moveFieldReact, so
+		corners are cut smoothly and there is no stop between segments.
+		The heading is steered at the same time, interpolated between
+		the waypoint headings, so it is independent of the direction of
+		travel: hold one heading for the whole path, or turn while
+		strafing.
+
+		Use:
+			pursuitClear();
+			pursuitAddWaypoint(x, y, heading);	... for every waypoint
+			pursuitStart(speed);
+			while( !pursuitStep() )							... every PURSUIT_CONTROL_PERIOD
+
+		Metrics, for comparing against segment by segment moves:
+			pursuitTimeLast			... ms from pursuitStart to the goal
+			pursuitCrossTrackRMS	... distance from the path, inches
+*/
+
+static float 	pursuitPathX[PURSUIT_PATH_MAX];
+static float 	pursuitPathY[PURSUIT_PATH_MAX];
+static float 	pursuitPathHeading[PURSUIT_PATH_MAX];
+static short 	pursuitPathLength 		= 0;
+
+static short 	pursuitSegment 				= 0;		// robot is between waypoint and waypoint + 1
+static float 	pursuitSegmentT 			= 0.0;	// 0..1 along that segment
+static short 	pursuitSpeed 					= 0;
+static bool 	bPursuitDone 					= true;
+
+static long 	pursuitStartTime 			= 0;
+static long 	pursuitTimeLast 			= 0;
+static float 	pursuitErrorSumSquares = 0.0;
+static long 	pursuitErrorSamples 	= 0;
+static float 	pursuitErrorMax 			= 0.0;
+
+// FUNCTION DECLARATIONS
+void 	pursuitClear();
+bool 	pursuitAddWaypoint(float x, float y, float heading);
+void 	pursuitStart(short speed);
+void 	pursuitReplaced();
+float pursuitSegmentDistance(short segment, float *t);
+float pursuitProject();
+float pursuitDistanceToGo();
+bool 	pursuitStep();
+float pursuitCrossTrackRMS();
+void 	pursuitReport(const string label);
+void 	runPathFollowerTest(short speed, float side);
+task 	pursuitMonitor();
+
+//==========================================================
+//	pursuitClear
+//	Start a new path with no waypoints
+//==========================================================
+void pursuitClear()
+{
+	pursuitPathLength = 0;
+	bPursuitDone 			= true;
+} // end pursuitClear
+
+//==========================================================
+//	pursuitAddWaypoint
+//	Append a waypoint, inches, with the heading to have there.
+//	Returns false if the path is full.
+//==========================================================
+bool pursuitAddWaypoint(float x, float y, float heading)
+{
+	if( pursuitPathLength >= PURSUIT_PATH_MAX )
+		return false;
+
+	pursuitPathX[pursuitPathLength] 			= x;
+	pursuitPathY[pursuitPathLength] 			= y;
+	pursuitPathHeading[pursuitPathLength] = heading;
+	pursuitPathLength += 1;
+	return true;
+} // end pursuitAddWaypoint
+
+//==========================================================
+//	pursuitStart
+//	Follow the path from its first segment at the given
+//	cruise speed, and clear the metrics
+//==========================================================
+void pursuitStart(short speed)
+{
+	pursuitSegment 	= 0;
+	pursuitSegmentT = 0.0;
+	pursuitSpeed 		= speed;
+	bPursuitDone 		= pursuitPathLength < 2;
+
+	pursuitStartTime 				= nSysTime;
+	pursuitErrorSumSquares 	= 0.0;
+	pursuitErrorSamples 		= 0;
+	pursuitErrorMax 				= 0.0;
+} // end pursuitStart
+
+//==========================================================
+//	pursuitReplaced
+//	Keep going after the waypoints were replaced with a new
+//	plan from where the robot is, the metrics keep running
+//==========================================================
+void pursuitReplaced()
+{
+	pursuitSegment 	= 0;
+	pursuitSegmentT = 0.0;
+	bPursuitDone 		= pursuitPathLength < 2;
+} // end pursuitReplaced
+
+//==========================================================
+//	pursuitSegmentDistance
+//	Distance in inches from the robot to a segment of the
+//	path, and in t how far along it (0..1) the nearest point is
+//==========================================================
+float pursuitSegmentDistance(short segment, float *t)
+{
+	float segX 	= pursuitPathX[segment + 1] - pursuitPathX[segment];
+	float segY 	= pursuitPathY[segment + 1] - pursuitPathY[segment];
+	float relX 	= odomX - pursuitPathX[segment];
+	float relY 	= odomY - pursuitPathY[segment];
+	float lengthSquared = segX * segX + segY * segY;
+
+	*t = 1.0;
+	if( lengthSquared > 0.0 )
+		*t = ( relX * segX + relY * segY ) / lengthSquared;
+
+	if( *t < 0.0 )
+		*t = 0.0;
+	if( *t > 1.0 )
+		*t = 1.0;
+
+	float errorX = relX - *t * segX;
+	float errorY = relY - *t * segY;
+	return sqrt(errorX * errorX + errorY * errorY);
+} // end pursuitSegmentDistance
+
+//==========================================================
+//	pursuitProject
+//	Project the robot onto the path, moving on to the next
+//	segment once the current one is passed, or once the
+//	robot is nearer the next one: it cut the corner, or
+//	stopped short of it and went on along the next segment.
+//	Adds to the cross track metrics and returns the cross
+//	track error, inches.
+//==========================================================
+float pursuitProject()
+{
+	float t 		= 0.0;
+	float error = pursuitSegmentDistance(pursuitSegment, &t);
+
+	while( pursuitSegment < pursuitPathLength - 2 )
+	{
+		float nextT 		= 0.0;
+		float nextError = pursuitSegmentDistance(pursuitSegment + 1, &nextT);
+		if( t < 1.0 && nextError >= error )
+			break;
+
+		pursuitSegment += 1;
+		t 		= nextT;
+		error = nextError;
+	} // end while
+	pursuitSegmentT = t;
+
+	pursuitErrorSumSquares += error * error;
+	pursuitErrorSamples 	 += 1;
+	if( error > pursuitErrorMax )
+		pursuitErrorMax = error;
+
+	return error;
+} // end pursuitProject
+
+//==========================================================
+//	pursuitDistanceToGo
+//	Length of the path from the robot's projection to the
+//	last waypoint, inches
+//==========================================================
+float pursuitDistanceToGo()
+{
+	float distance = 0.0;
+
+	for( int i = pursuitSegment; i < pursuitPathLength - 1; i++ )
+	{
+		float segX = pursuitPathX[i + 1] - pursuitPathX[i];
+		float segY = pursuitPathY[i + 1] - pursuitPathY[i];
+		float length = sqrt(segX * segX + segY * segY);
+
+		if( i == pursuitSegment )
+			length *= 1.0 - pursuitSegmentT;
+		distance += length;
+	}
+
+	return distance;
+} // end pursuitDistanceToGo
+
+//==========================================================
+//	pursuitStep
+//	One control tick of the follower, every
+//	PURSUIT_CONTROL_PERIOD.
+//	Returns true once the last waypoint is reached, the
+//	motors are stopped then.
+//==========================================================
+bool pursuitStep()
+{
+	if( bPursuitDone )
+		return true;
+
+	pursuitProject();
+
+	float toGo = pursuitDistanceToGo();
+	short last = pursuitPathLength - 1;
+
+	float goalX = pursuitPathX[last] - odomX;
+	float goalY = pursuitPathY[last] - odomY;
+	if( pursuitSegment == last - 1 &&
+			sqrt(goalX * goalX + goalY * goalY) < PURSUIT_GOAL_TOLERANCE )
+	{
+		moveStopReact();
+		bPursuitDone 		= true;
+		pursuitTimeLast = nSysTime - pursuitStartTime;
+		return true;
+	}
+
+	// walk PURSUIT_LOOKAHEAD inches along the path from the projection
+	short segment = pursuitSegment;
+	float t 			= pursuitSegmentT;
+	float ahead 	= PURSUIT_LOOKAHEAD;
+	float targetX = pursuitPathX[last];
+	float targetY = pursuitPathY[last];
+	float targetHeading = pursuitPathHeading[last];
+
+	while( segment < last )
+	{
+		float segX = pursuitPathX[segment + 1] - pursuitPathX[segment];
+		float segY = pursuitPathY[segment + 1] - pursuitPathY[segment];
+		float length = sqrt(segX * segX + segY * segY);
+		float left = length * (1.0 - t);
+
+		if( ahead <= left && length > 0.0 )
+		{
+			t += ahead / length;
+			targetX = pursuitPathX[segment] + t * segX;
+			targetY = pursuitPathY[segment] + t * segY;
+			targetHeading = pursuitPathHeading[segment] +
+				t * angleDifference(pursuitPathHeading[segment + 1], pursuitPathHeading[segment]);
+			break;
+		}
+
+		ahead 	-= left;
+		segment += 1;
+		t 			 = 0.0;
+	} // end while
+
+	// slow down over the last few inches
+	float speed = PURSUIT_SPEED_KP * toGo;
+	if( speed > pursuitSpeed )
+		speed = pursuitSpeed;
+	if( speed < PURSUIT_SPEED_MIN )
+		speed = PURSUIT_SPEED_MIN;
+
+	float dx = targetX - odomX;
+	float dy = targetY - odomY;
+	float distance = sqrt(dx * dx + dy * dy);
+	if( distance < 0.1 )
+		distance = 0.1;
+
+	moveFieldReact( speed * dx / distance, speed * dy / distance, targetHeading );
+	return false;
+} // end pursuitStep
+
+//==========================================================
+//	pursuitCrossTrackRMS
+//	Root mean square distance from the path, inches
+//==========================================================
+float pursuitCrossTrackRMS()
+{
+	if( pursuitErrorSamples == 0 )
+		return 0.0;
+
+	return sqrt( pursuitErrorSumSquares / pursuitErrorSamples );
+} // end pursuitCrossTrackRMS
+
+//==========================================================
+//	pursuitReport
+//	Write the run metrics to the debug stream
+//==========================================================
+void pursuitReport(const string label)
+{
+	writeDebugStreamLine("%s: %d ms cross track rms: %f in max: %f in",
+												label, pursuitTimeLast,
+												pursuitCrossTrackRMS(), pursuitErrorMax);
+} // end pursuitReport
+
+//==========================================================
+//	pursuitMonitor
+//	Measure the cross track error of the path while some
+//	other code drives, used to benchmark the moveXXX functions
+//==========================================================
+task pursuitMonitor()
+{
+	while( true )
+	{
+		pursuitProject();
+		wait1Msec(PURSUIT_CONTROL_PERIOD);
+	}
+} // end pursuitMonitor
+
+//==========================================================
+//	runPathFollowerTest
+//	Drive a square with sides of the given length twice:
+//	first segment by segment with moveForward,
+//	moveTraverseRight, moveBackward and moveTraverseLeft,
+//	then as one path with the pure pursuit follower.
+//	Completion time and cross track error of both runs go
+//	to the debug stream.
+//==========================================================
+void runPathFollowerTest(short speed, float side)
+{
+	writeDebugStreamLine("runPathFollowerTest speed=%d", speed );
+
+	lcdClearLine(0);
+	lcdClearLine(1);
+	lcdCenteredString(0,"Driving Test:");
+	lcdCenteredString(1,"Path Segments");
+	lcdCommit();
+
+	long 	segmentsTime 	= 0;
+	float segmentsRMS 	= 0.0;
+
+	for( int run = 0; run < 2; run++ )
+	{
+		// the square starts where the robot is, in the robot frame
+		odometryUpdate();
+		float heading = degreesToRadians(odomHeading);
+		float frontX 	= side * cos(heading);
+		float frontY 	= side * sin(heading);
+		float rightX 	= side * sin(heading);
+		float rightY 	= -side * cos(heading);
+
+		pursuitClear();
+		pursuitAddWaypoint(odomX, 										odomY, 										odomHeading);
+		pursuitAddWaypoint(odomX + frontX, 						odomY + frontY, 					odomHeading);
+		pursuitAddWaypoint(odomX + frontX + rightX, 	odomY + frontY + rightY, 	odomHeading);
+		pursuitAddWaypoint(odomX + rightX, 						odomY + rightY, 					odomHeading);
+		pursuitAddWaypoint(odomX, 										odomY, 										odomHeading);
+		pursuitStart(speed);
+
+		if( run == 0 )
+		{
+			startTask(pursuitMonitor);
+			moveForward(speed, 0, side);
+			moveTraverseRight(speed, 0, side);
+			moveBackward(speed, 0, side);
+			moveTraverseLeft(speed, 0, side);
+			stopTask(pursuitMonitor);
+
+			pursuitTimeLast = nSysTime - pursuitStartTime;
+			pursuitReport("segments");
+			segmentsTime 	= pursuitTimeLast;
+			segmentsRMS 	= pursuitCrossTrackRMS();
+
+			lcdClearLine(1);
+			lcdCenteredString(1,"Pure Pursuit");
+			lcdCommit();
+			wait1Msec(1000);
+		}
+		else
+		{
+			long nextTick = nSysTime;
+			while( !pursuitStep() )
+			{
+				// EMERGENCY!!! COLLISION DETECTED
+				if( collisionDetected() || nSysTime - pursuitStartTime > PURSUIT_TIMEOUT )
+				{
+					stopAllMotors();
+					pursuitTimeLast = nSysTime - pursuitStartTime;
+					break;
+				}
+
+				nextTick += PURSUIT_CONTROL_PERIOD;
+				if( nextTick > nSysTime )
+					wait1Msec( nextTick - nSysTime );
+				else
+					nextTick = nSysTime;
+			}
+			pursuitReport("pursuit");
+		}
+	} // end for
+
+	lcdClearLine(0);
+	lcdClearLine(1);
+	// time in ms and rms error in tenths of an inch
+	lcdString(0, 0, "SEG");
+	lcdNumber(0, 4, segmentsTime);
+	lcdNumber(0, 11, (int)( segmentsRMS * 10 ));
+	lcdString(1, 0, "PP");
+	lcdNumber(1, 4, pursuitTimeLast);
+	lcdNumber(1, 11, (int)( pursuitCrossTrackRMS() * 10 ));
+	lcdCommit();
+	wait1Msec(5000); // time to read the results
+} // end runPathFollowerTest
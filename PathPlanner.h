@@ -0,0 +1,744 @@
+/*
+		PathPlanner.h
+		Incremental path planner (D* Lite) over the robot's map.
+
+		The planner works on a PLAN_SIZE x PLAN_SIZE grid of plan cells,
+		each PLAN_CELL_CELLS x PLAN_CELL_CELLS map cells, placed around the
+		start and the goal when plannerInit is called. A plan cell is
+		blocked if any map cell under it, or within PLAN_INFLATE map cells
+		of it, is occupied (mapGetState), which keeps the chassis clear of
+		walls.
+
+		Moves: all eight DIRECTION_XXX neighbors. The robot keeps its
+		heading while it follows a path, so the cost of a move depends on
+		how much of it is strafing:
+			cost = PLAN_COST_UNIT * length * ( |cos a| + |sin a| / MOVEMENT_LATERAL_ADJUSTER )
+		where a is the angle between the move and the robot heading.
+		Straight ahead costs 10, a pure strafe 22, a diagonal 32.
+		A diagonal may not cut the corner of a blocked cell.
+
+		A goal on a blocked plan cell, against a wall or in its
+		clearance, has no path. plannerInit moves it to the nearest
+		free plan cell within PLAN_GOAL_SNAP instead, the goal reached
+		is then that cell's center (plannerCellCenterX/Y of planGoal).
+
+		D* Lite searches from the goal back to the robot. When the map
+		changes (the occupancy grid change queue) only the plan cells
+		around the change are updated, and the search picks up from
+		where it left off instead of starting over.
+
+		The open list is a binary heap of fixed capacity PLAN_CELLS,
+		with the heap position of every cell kept in planHeapPos so
+		a cell can be updated or removed in O(log n). No dynamic
+		allocation.
+
+		Memory (PLAN_CELLS = 256): g, rhs, heap position, heap cell
+		(shorts) 2048 bytes, heap keys (ints) 2048 bytes, blocked flags
+		256 bytes.
+*/
+
+// D* Lite state, per plan cell
+static short 	planG[PLAN_CELLS];
+static short 	planRhs[PLAN_CELLS];
+static bool 	bPlanBlocked[PLAN_CELLS];
+
+// open list, a binary heap ordered by [ key1; key2 ]
+static short 	planHeapCell[PLAN_CELLS];
+static int 		planHeapKey1[PLAN_CELLS];
+static int 		planHeapKey2[PLAN_CELLS];
+static short 	planHeapPos[PLAN_CELLS];	// -1 if not in the heap
+static short 	planHeapCount 			= 0;
+
+// search
+static int 		planOriginX 				= 0;	// world map cell of plan cell 0, 0
+static int 		planOriginY 				= 0;
+static short 	planStart 					= 0;
+static short 	planGoal 						= 0;
+static short 	planLast 						= 0;	// start when km was last updated
+static int 		planKm 							= 0;
+static short 	planStepCost[8];					// by neighbor, see planNeighborX
+
+// neighbors, in DIRECTION_XXX order: index * 45 degrees
+static const short planNeighborX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const short planNeighborY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+// extracted path, world inches
+static float 	planPathX[PLAN_PATH_MAX];
+static float 	planPathY[PLAN_PATH_MAX];
+static short 	planPathLength 			= 0;
+
+// measurements
+static long 	planExpansions 			= 0;
+static long 	planTimeLast 				= 0;	// ms for the last plan or repair
+
+// FUNCTION DECLARATIONS
+bool 	plannerInit(float startX, float startY, float goalX, float goalY, float heading);
+short plannerCellAt(float x, float y);
+short plannerNearestFree(short cell);
+float plannerCellCenterX(short cell);
+float plannerCellCenterY(short cell);
+bool 	plannerCellBlocked(short cell);
+int 	plannerHeuristic(short from, short to);
+int 	plannerCost(short from, short direction);
+void 	plannerCalculateKey(short cell, int *key1, int *key2);
+bool 	plannerKeyLess(int a1, int a2, int b1, int b2);
+void 	plannerHeapSwap(short i, short j);
+void 	plannerHeapUp(short i);
+void 	plannerHeapDown(short i);
+void 	plannerHeapPush(short cell);
+void 	plannerHeapRemove(short cell);
+short plannerHeapPop();
+int 	plannerBestRhs(short cell);
+void 	plannerUpdateVertex(short cell);
+void 	plannerComputeShortestPath();
+void 	plannerCellChanged(short cell);
+void 	plannerUpdateMap();
+bool 	plannerExtractPath();
+bool 	plannerReplan(float x, float y);
+
+//====================================================================
+//	plannerInit
+//	Place the plan grid around start and goal (world inches),
+//	with the robot holding heading (degrees) along the path,
+//	and plan the first path.
+//	Returns false if start and goal do not both fit in the plan
+//	grid, or there is no path.
+//====================================================================
+bool plannerInit(float startX, float startY, float goalX, float goalY, float heading)
+{
+	writeDebugStreamLine("plannerInit");
+
+	long startTime = nSysTime;
+
+	// center the plan grid between start and goal
+	planOriginX = mapWorldToCell( (startX + goalX) / 2.0 )
+								- PLAN_SIZE * PLAN_CELL_CELLS / 2;
+	planOriginY = mapWorldToCell( (startY + goalY) / 2.0 )
+								- PLAN_SIZE * PLAN_CELL_CELLS / 2;
+
+	// forget the last plan first, so a plannerReplan after a
+	// failed plannerInit finds an empty open list, not stale keys
+	planHeapCount 	= 0;
+	planKm 					= 0;
+	planExpansions 	= 0;
+	planPathLength 	= 0;
+	for( int i = 0; i < PLAN_CELLS; i++ )
+	{
+		planG[i] 				= PLAN_INFINITY;
+		planRhs[i] 			= PLAN_INFINITY;
+		planHeapPos[i] 	= -1;
+	}
+
+	planStart = plannerCellAt(startX, startY);
+	planGoal 	= plannerCellAt(goalX, goalY);
+	if( planStart < 0 || planGoal < 0 )
+	{
+		writeDebugStreamLine("plannerInit start or goal too far apart");
+		return false;
+	}
+
+	// cost of a step in every direction, for this heading
+	for( int i = 0; i < 8; i++ )
+	{
+		float angle = degreesToRadians( i * 45 - heading );
+		float length = 1.0;
+		if( planNeighborX[i] != 0 && planNeighborY[i] != 0 )
+			length = 1.414;
+
+		planStepCost[i] = (short)( PLAN_COST_UNIT * length *
+			( abs(cos(angle)) + abs(sin(angle)) / MOVEMENT_LATERAL_ADJUSTER ) + 0.5 );
+	}
+
+	for( int i = 0; i < PLAN_CELLS; i++ )
+	{
+		bPlanBlocked[i] = plannerCellBlocked(i);
+	}
+
+	// a goal against a wall has no path, take the free
+	// plan cell nearest to it
+	if( bPlanBlocked[planGoal] )
+	{
+		planGoal = plannerNearestFree(planGoal);
+		if( planGoal < 0 )
+		{
+			writeDebugStreamLine("plannerInit goal blocked");
+			return false;
+		}
+	}
+
+	planLast = planStart;
+
+	// the goal needs no travel to reach the goal
+	planRhs[planGoal] = 0;
+	plannerHeapPush(planGoal);
+
+	// everything already known is now in bPlanBlocked
+	mapChangeTail 			= mapChangeHead;
+	bMapChangeOverflow 	= false;
+
+	plannerComputeShortestPath();
+	bool bFound = plannerExtractPath();
+
+	planTimeLast = nSysTime - startTime;
+	writeDebugStreamLine("plannerInit %d ms, %d expansions", planTimeLast, planExpansions);
+
+	return bFound;
+} // end plannerInit
+
+//====================================================================
+//	plannerCellAt
+//	Plan cell of a world position in inches,
+//	-1 if outside the plan grid
+//====================================================================
+short plannerCellAt(float x, float y)
+{
+	int cellX = mapWorldToCell(x) - planOriginX;
+	int cellY = mapWorldToCell(y) - planOriginY;
+
+	if( cellX < 0 || cellY < 0 )
+		return -1;
+
+	cellX = cellX / PLAN_CELL_CELLS;
+	cellY = cellY / PLAN_CELL_CELLS;
+
+	if( cellX >= PLAN_SIZE || cellY >= PLAN_SIZE )
+		return -1;
+
+	return cellY * PLAN_SIZE + cellX;
+} // end plannerCellAt
+
+//====================================================================
+//	plannerNearestFree
+//	The free plan cell nearest to cell, at most PLAN_GOAL_SNAP
+//	plan cells away on each axis, -1 if there is none.
+//	Needs bPlanBlocked, see plannerInit.
+//====================================================================
+short plannerNearestFree(short cell)
+{
+	int 	cellX 		= cell % PLAN_SIZE;
+	int 	cellY 		= cell / PLAN_SIZE;
+	short best 			= -1;
+	int 	bestSquare 	= 0;
+
+	for( int y = cellY - PLAN_GOAL_SNAP; y <= cellY + PLAN_GOAL_SNAP; y++ )
+	{
+		for( int x = cellX - PLAN_GOAL_SNAP; x <= cellX + PLAN_GOAL_SNAP; x++ )
+		{
+			if( x < 0 || y < 0 || x >= PLAN_SIZE || y >= PLAN_SIZE )
+				continue;
+
+			short other = y * PLAN_SIZE + x;
+			if( bPlanBlocked[other] )
+				continue;
+
+			int square = (x - cellX) * (x - cellX) + (y - cellY) * (y - cellY);
+			if( best < 0 || square < bestSquare )
+			{
+				best 				= other;
+				bestSquare 	= square;
+			}
+		}
+	}
+
+	return best;
+} // end plannerNearestFree
+
+//====================================================================
+//	plannerCellCenterX, plannerCellCenterY
+//	World position in inches of the center of a plan cell
+//====================================================================
+float plannerCellCenterX(short cell)
+{
+	return ( planOriginX + (cell % PLAN_SIZE) * PLAN_CELL_CELLS
+					 + PLAN_CELL_CELLS / 2.0 ) * MAP_CELL_SIZE;
+} // end plannerCellCenterX
+
+float plannerCellCenterY(short cell)
+{
+	return ( planOriginY + (cell / PLAN_SIZE) * PLAN_CELL_CELLS
+					 + PLAN_CELL_CELLS / 2.0 ) * MAP_CELL_SIZE;
+} // end plannerCellCenterY
+
+//====================================================================
+//	plannerCellBlocked
+//	true if any map cell under the plan cell, or within
+//	PLAN_INFLATE map cells of it, is occupied
+//====================================================================
+bool plannerCellBlocked(short cell)
+{
+	int firstX = planOriginX + (cell % PLAN_SIZE) * PLAN_CELL_CELLS - PLAN_INFLATE;
+	int firstY = planOriginY + (cell / PLAN_SIZE) * PLAN_CELL_CELLS - PLAN_INFLATE;
+	int span 	 = PLAN_CELL_CELLS + 2 * PLAN_INFLATE;
+
+	for( int y = firstY; y < firstY + span; y++ )
+	{
+		for( int x = firstX; x < firstX + span; x++ )
+		{
+			if( mapGetState(x, y) == MAP_STATE_OCCUPIED )
+				return true;
+		}
+	}
+
+	return false;
+} // end plannerCellBlocked
+
+//====================================================================
+//	plannerHeuristic
+//	Never more than the real cost: every step costs at least
+//	PLAN_COST_UNIT and moves at most one cell on each axis
+//====================================================================
+int plannerHeuristic(short from, short to)
+{
+	int dx = abs( from % PLAN_SIZE - to % PLAN_SIZE );
+	int dy = abs( from / PLAN_SIZE - to / PLAN_SIZE );
+
+	if( dx > dy )
+		return PLAN_COST_UNIT * dx;
+
+	return PLAN_COST_UNIT * dy;
+} // end plannerHeuristic
+
+//====================================================================
+//	plannerCost
+//	Cost of stepping from a plan cell to its neighbor in the
+//	given direction (index into planNeighborX), PLAN_INFINITY if
+//	the step leaves the grid or touches a blocked cell.
+//	The cost is the same both ways, so the planner can use the
+//	same neighbors for successors and predecessors.
+//====================================================================
+int plannerCost(short from, short direction)
+{
+	int x = from % PLAN_SIZE;
+	int y = from / PLAN_SIZE;
+	int toX = x + planNeighborX[direction];
+	int toY = y + planNeighborY[direction];
+
+	if( toX < 0 || toX >= PLAN_SIZE || toY < 0 || toY >= PLAN_SIZE )
+		return PLAN_INFINITY;
+
+	if( bPlanBlocked[from] || bPlanBlocked[toY * PLAN_SIZE + toX] )
+		return PLAN_INFINITY;
+
+	// diagonal: do not cut the corner of a blocked cell
+	if( planNeighborX[direction] != 0 && planNeighborY[direction] != 0 )
+	{
+		if( bPlanBlocked[y * PLAN_SIZE + toX] || bPlanBlocked[toY * PLAN_SIZE + x] )
+			return PLAN_INFINITY;
+	}
+
+	return planStepCost[direction];
+} // end plannerCost
+
+//====================================================================
+//	plannerCalculateKey
+//	D* Lite priority of a cell
+//====================================================================
+void plannerCalculateKey(short cell, int *key1, int *key2)
+{
+	int best = planG[cell];
+	if( planRhs[cell] < best )
+		best = planRhs[cell];
+
+	*key2 = best;
+	*key1 = best + plannerHeuristic(planStart, cell) + planKm;
+} // end plannerCalculateKey
+
+//====================================================================
+//	plannerKeyLess
+//	true if key [a1; a2] comes before key [b1; b2]
+//====================================================================
+bool plannerKeyLess(int a1, int a2, int b1, int b2)
+{
+	if( a1 != b1 )
+		return a1 < b1;
+
+	return a2 < b2;
+} // end plannerKeyLess
+
+//====================================================================
+//	plannerHeapSwap, plannerHeapUp, plannerHeapDown
+//	Binary heap maintenance, keeping planHeapPos in step
+//====================================================================
+void plannerHeapSwap(short i, short j)
+{
+	short cell 	= planHeapCell[i];
+	int key1 		= planHeapKey1[i];
+	int key2 		= planHeapKey2[i];
+
+	planHeapCell[i] = planHeapCell[j];
+	planHeapKey1[i] = planHeapKey1[j];
+	planHeapKey2[i] = planHeapKey2[j];
+
+	planHeapCell[j] = cell;
+	planHeapKey1[j] = key1;
+	planHeapKey2[j] = key2;
+
+	planHeapPos[ planHeapCell[i] ] = i;
+	planHeapPos[ planHeapCell[j] ] = j;
+} // end plannerHeapSwap
+
+void plannerHeapUp(short i)
+{
+	while( i > 0 )
+	{
+		short parent = (i - 1) / 2;
+		if( !plannerKeyLess( planHeapKey1[i], planHeapKey2[i],
+												 planHeapKey1[parent], planHeapKey2[parent] ) )
+			break;
+		plannerHeapSwap(i, parent);
+		i = parent;
+	}
+} // end plannerHeapUp
+
+void plannerHeapDown(short i)
+{
+	while( true )
+	{
+		short smallest 	= i;
+		short left 			= 2 * i + 1;
+		short right 		= 2 * i + 2;
+
+		if( left < planHeapCount &&
+				plannerKeyLess( planHeapKey1[left], planHeapKey2[left],
+												planHeapKey1[smallest], planHeapKey2[smallest] ) )
+			smallest = left;
+		if( right < planHeapCount &&
+				plannerKeyLess( planHeapKey1[right], planHeapKey2[right],
+												planHeapKey1[smallest], planHeapKey2[smallest] ) )
+			smallest = right;
+
+		if( smallest == i )
+			break;
+		plannerHeapSwap(i, smallest);
+		i = smallest;
+	}
+} // end plannerHeapDown
+
+//====================================================================
+//	plannerHeapPush
+//	Insert a cell, or move it if it is already in the heap,
+//	with its current key
+//====================================================================
+void plannerHeapPush(short cell)
+{
+	int key1 = 0;
+	int key2 = 0;
+	plannerCalculateKey(cell, &key1, &key2);
+
+	short i = planHeapPos[cell];
+	if( i < 0 )
+	{
+		// every cell is in the heap at most once,
+		// so PLAN_CELLS entries are always enough
+		i = planHeapCount;
+		planHeapCount += 1;
+		planHeapCell[i] = cell;
+		planHeapPos[cell] = i;
+	}
+
+	planHeapKey1[i] = key1;
+	planHeapKey2[i] = key2;
+	plannerHeapUp(i);
+	plannerHeapDown( planHeapPos[cell] );
+} // end plannerHeapPush
+
+//====================================================================
+//	plannerHeapRemove
+//	Take a cell out of the heap, if it is there
+//====================================================================
+void plannerHeapRemove(short cell)
+{
+	short i = planHeapPos[cell];
+	if( i < 0 )
+		return;
+
+	planHeapCount -= 1;
+	if( i != planHeapCount )
+	{
+		plannerHeapSwap(i, planHeapCount);
+		plannerHeapUp(i);
+		plannerHeapDown(i);
+	}
+	planHeapPos[cell] = -1;
+} // end plannerHeapRemove
+
+//====================================================================
+//	plannerHeapPop
+//	Remove and return the cell with the smallest key
+//====================================================================
+short plannerHeapPop()
+{
+	short cell = planHeapCell[0];
+	plannerHeapRemove(cell);
+	return cell;
+} // end plannerHeapPop
+
+//====================================================================
+//	plannerBestRhs
+//	Cheapest way to the goal through any neighbor
+//====================================================================
+int plannerBestRhs(short cell)
+{
+	int best = PLAN_INFINITY;
+
+	for( int i = 0; i < 8; i++ )
+	{
+		int cost = plannerCost(cell, i);
+		if( cost >= PLAN_INFINITY )
+			continue;
+
+		short neighbor = cell + planNeighborY[i] * PLAN_SIZE + planNeighborX[i];
+		int total = cost + planG[neighbor];
+		if( total < best )
+			best = total;
+	}
+
+	if( best > PLAN_INFINITY )
+		best = PLAN_INFINITY;
+
+	return best;
+} // end plannerBestRhs
+
+//====================================================================
+//	plannerUpdateVertex
+//	Recompute rhs of a cell and put it in the open list if it
+//	is inconsistent (g != rhs)
+//====================================================================
+void plannerUpdateVertex(short cell)
+{
+	if( cell != planGoal )
+		planRhs[cell] = plannerBestRhs(cell);
+
+	if( planG[cell] != planRhs[cell] )
+		plannerHeapPush(cell);
+	else
+		plannerHeapRemove(cell);
+} // end plannerUpdateVertex
+
+//====================================================================
+//	plannerComputeShortestPath
+//	Expand cells until the start is consistent and nothing in
+//	the open list can improve it
+//====================================================================
+void plannerComputeShortestPath()
+{
+	int startKey1 = 0;
+	int startKey2 = 0;
+	int newKey1 = 0;
+	int newKey2 = 0;
+
+	while( planHeapCount > 0 )
+	{
+		plannerCalculateKey(planStart, &startKey1, &startKey2);
+		if( !plannerKeyLess( planHeapKey1[0], planHeapKey2[0], startKey1, startKey2 ) &&
+				planRhs[planStart] <= planG[planStart] )
+			break;
+
+		short cell = planHeapCell[0];
+		plannerCalculateKey(cell, &newKey1, &newKey2);
+		planExpansions += 1;
+
+		if( plannerKeyLess( planHeapKey1[0], planHeapKey2[0], newKey1, newKey2 ) )
+		{
+			// key is out of date since the robot moved, requeue
+			plannerHeapPush(cell);
+		}
+		else if( planG[cell] > planRhs[cell] )
+		{
+			// overconsistent, the cell got cheaper
+			planG[cell] = planRhs[cell];
+			plannerHeapPop();
+			for( int i = 0; i < 8; i++ )
+			{
+				if( plannerCost(cell, i) < PLAN_INFINITY )
+					plannerUpdateVertex( cell + planNeighborY[i] * PLAN_SIZE + planNeighborX[i] );
+			}
+		}
+		else
+		{
+			// underconsistent, the cell got more expensive
+			planG[cell] = PLAN_INFINITY;
+			plannerUpdateVertex(cell);
+			for( int i = 0; i < 8; i++ )
+			{
+				int x = cell % PLAN_SIZE + planNeighborX[i];
+				int y = cell / PLAN_SIZE + planNeighborY[i];
+				if( x >= 0 && x < PLAN_SIZE && y >= 0 && y < PLAN_SIZE )
+					plannerUpdateVertex( y * PLAN_SIZE + x );
+			}
+		}
+	} // end while
+} // end plannerComputeShortestPath
+
+//====================================================================
+//	plannerCellChanged
+//	A plan cell may have become blocked or clear. If it did,
+//	every edge touching it changed cost, so update it and its
+//	neighbors.
+//====================================================================
+void plannerCellChanged(short cell)
+{
+	bool bBlocked = plannerCellBlocked(cell);
+	if( bBlocked == bPlanBlocked[cell] )
+		return;
+
+	bPlanBlocked[cell] = bBlocked;
+
+	plannerUpdateVertex(cell);
+	for( int i = 0; i < 8; i++ )
+	{
+		int x = cell % PLAN_SIZE + planNeighborX[i];
+		int y = cell / PLAN_SIZE + planNeighborY[i];
+		if( x >= 0 && x < PLAN_SIZE && y >= 0 && y < PLAN_SIZE )
+			plannerUpdateVertex( y * PLAN_SIZE + x );
+	}
+} // end plannerCellChanged
+
+//====================================================================
+//	plannerUpdateMap
+//	Read the occupancy grid change queue and update every plan
+//	cell whose inflated footprint covers a changed map cell
+//====================================================================
+void plannerUpdateMap()
+{
+	int cellX = 0;
+	int cellY = 0;
+
+	if( bMapChangeOverflow )
+	{
+		// too many changes to track one by one, check them all
+		bMapChangeOverflow = false;
+		mapChangeTail = mapChangeHead;
+		for( int i = 0; i < PLAN_CELLS; i++ )
+		{
+			plannerCellChanged(i);
+		}
+		return;
+	}
+
+	while( mapNextChange(&cellX, &cellY) )
+	{
+		// plan cells within PLAN_INFLATE map cells of the change
+		int firstX = cellX - planOriginX - PLAN_INFLATE;
+		int firstY = cellY - planOriginY - PLAN_INFLATE;
+		int lastX  = cellX - planOriginX + PLAN_INFLATE;
+		int lastY  = cellY - planOriginY + PLAN_INFLATE;
+
+		if( lastX < 0 || lastY < 0 )
+			continue;
+		if( firstX < 0 )
+			firstX = 0;
+		if( firstY < 0 )
+			firstY = 0;
+
+		for( int y = firstY / PLAN_CELL_CELLS; y <= lastY / PLAN_CELL_CELLS; y++ )
+		{
+			for( int x = firstX / PLAN_CELL_CELLS; x <= lastX / PLAN_CELL_CELLS; x++ )
+			{
+				if( x < PLAN_SIZE && y < PLAN_SIZE )
+					plannerCellChanged( y * PLAN_SIZE + x );
+			}
+		}
+	}
+} // end plannerUpdateMap
+
+//====================================================================
+//	plannerExtractPath
+//	Walk downhill from the start to the goal, writing the plan
+//	cell centers where the direction changes into planPathX/Y.
+//	Returns false if the goal cannot be reached.
+//====================================================================
+bool plannerExtractPath()
+{
+	planPathLength = 0;
+
+	if( planG[planStart] >= PLAN_INFINITY && planRhs[planStart] >= PLAN_INFINITY )
+		return false;
+
+	short cell = planStart;
+	short lastDirection = -1;
+
+	planPathX[0] = plannerCellCenterX(cell);
+	planPathY[0] = plannerCellCenterY(cell);
+	planPathLength = 1;
+
+	for( int steps = 0; steps < PLAN_CELLS && cell != planGoal; steps++ )
+	{
+		short bestDirection = -1;
+		int best = PLAN_INFINITY;
+
+		for( int i = 0; i < 8; i++ )
+		{
+			int cost = plannerCost(cell, i);
+			if( cost >= PLAN_INFINITY )
+				continue;
+
+			int total = cost + planG[ cell + planNeighborY[i] * PLAN_SIZE + planNeighborX[i] ];
+			if( total < best )
+			{
+				best = total;
+				bestDirection = i;
+			}
+		}
+
+		if( bestDirection < 0 )
+			return false;
+
+		cell = cell + planNeighborY[bestDirection] * PLAN_SIZE + planNeighborX[bestDirection];
+
+		if( bestDirection == lastDirection )
+		{
+			// same direction, move the last corner along
+			planPathX[planPathLength - 1] = plannerCellCenterX(cell);
+			planPathY[planPathLength - 1] = plannerCellCenterY(cell);
+		}
+		else
+		{
+			// only keep the corners of the path
+			if( planPathLength >= PLAN_PATH_MAX )
+				return false;
+			planPathX[planPathLength] = plannerCellCenterX(cell);
+			planPathY[planPathLength] = plannerCellCenterY(cell);
+			planPathLength += 1;
+		}
+		lastDirection = bestDirection;
+	}
+
+	return cell == planGoal;
+} // end plannerExtractPath
+
+//====================================================================
+//	plannerReplan
+//	The robot is now at x, y (world inches). Repair the plan for
+//	the map changes since the last call and extract the new path.
+//	Returns false if the goal cannot be reached, or the robot
+//	left the plan grid.
+//====================================================================
+bool plannerReplan(float x, float y)
+{
+	long startTime = nSysTime;
+	long expansionsBefore = planExpansions;
+
+	short cell = plannerCellAt(x, y);
+	if( cell < 0 )
+		return false;
+
+	// the heuristic is measured from the start, which moved
+	if( cell != planStart )
+	{
+		planKm += plannerHeuristic(planLast, cell);
+		planLast = cell;
+		planStart = cell;
+	}
+
+	plannerUpdateMap();
+	plannerComputeShortestPath();
+	bool bFound = plannerExtractPath();
+
+	planTimeLast = nSysTime - startTime;
+	if( planExpansions != expansionsBefore )
+		writeDebugStreamLine("plannerReplan %d ms, %d expansions",
+													planTimeLast, planExpansions - expansionsBefore);
+
+	return bFound;
+} // end plannerReplan
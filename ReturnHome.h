@@ -0,0 +1,339 @@
+/*
+		ReturnHome.h
+		Drive back to the home pose for returnHomeMode.
+
+		Home is the odometry pose recorded by homeRecord when a mode
+		is picked from the menu, so after a run in defensiveMode or
+		behavioralMode the robot can bring itself back to where that
+		run started. The return goes through
+		-	PLAN			plan a path (PathPlanner.h) to home, or to the point
+								HOME_LEG_RANGE inches toward it if home is further
+								away than the plan grid reaches
+		-	DRIVE			follow it with pure pursuit (PathFollower.h), with the
+								map updated from the sonars and the plan repaired
+								every HOME_REPLAN_PERIOD; the sonar facing the way
+								the robot is going stops it and forces a replan
+		-	APPROACH	the last HOME_APPROACH_DISTANCE inches straight at
+								home, slowing down to HOME_APPROACH_SPEED_MIN, until
+								within HOME_TOLERANCE
+		-	ALIGN			turn in place to the home heading
+		-	DONE
+		If no path is found the robot waits in BLOCKED and tries again
+		every HOME_RETRY_PERIOD, the sonars may have cleared the way.
+		A leg goal in a wall or too close to one is moved to a free
+		cell by the planner (PLAN_GOAL_SNAP), and every failed try
+		shortens the next leg, to HOME_LEG_RANGE / (tries + 1). A leg
+		that ends less than HOME_PROGRESS_MIN closer to home counts as
+		failed too. After HOME_RETRY_MAX failed tries in a row the robot
+		gives up: DONE with bHomeFailed set.
+*/
+
+static short 	homeState 						= HOME_DONE;
+static float 	homeLegX 							= 0.0;	// goal of the current leg
+static float 	homeLegY 							= 0.0;
+static long 	homeStateTime 				= 0;
+static long 	homeReplanTime 				= 0;
+static long 	homeStartTime 				= 0;
+static short 	homeRetries 					= 0;		// failed tries in a row
+static float 	homeLegDistance 			= 0.0;	// from home when the leg started
+static bool 	bHomeLegDriven 				= false;
+static bool 	bHomeFailed 					= false;
+
+// FUNCTION DECLARATIONS
+void 	homeRecord();
+void 	homeStart();
+float homeDistance();
+bool 	homePlanLeg();
+void 	homeLoadPath(bool bNewLeg);
+bool 	homeWayBlocked();
+void 	homeFailedTry();
+short homeStep();
+
+//==========================================================
+//	homeRecord
+//	Make the current pose home
+//==========================================================
+void homeRecord()
+{
+	odometryUpdate();
+
+	homeX 			= odomX;
+	homeY 			= odomY;
+	homeHeading = odomHeading;
+} // end homeRecord
+
+//==========================================================
+//	homeStart
+//	Start the way back from wherever the robot is
+//==========================================================
+void homeStart()
+{
+	writeDebugStreamLine("homeStart %d, %d -> %d, %d",
+												(int)odomX, (int)odomY, (int)homeX, (int)homeY);
+
+	mapStart();
+
+	homeStartTime 	= nSysTime;
+	homeStateTime 	= nSysTime;
+	homeRetries 		= 0;
+	bHomeLegDriven 	= false;
+	bHomeFailed 		= false;
+	homeState 			= HOME_PLAN;
+} // end homeStart
+
+//==========================================================
+//	homeDistance
+//	Straight line distance to home, inches
+//==========================================================
+float homeDistance()
+{
+	float dx = homeX - odomX;
+	float dy = homeY - odomY;
+
+	return sqrt(dx * dx + dy * dy);
+} // end homeDistance
+
+//==========================================================
+//	homePlanLeg
+//	Plan the next leg toward home, shorter after each failed
+//	try. Returns false if there is no way.
+//==========================================================
+bool homePlanLeg()
+{
+	float distance 	= homeDistance();
+	float range 		= HOME_LEG_RANGE / (homeRetries + 1);
+
+	homeLegX = homeX;
+	homeLegY = homeY;
+	if( distance > range )
+	{
+		homeLegX = odomX + (homeX - odomX) * range / distance;
+		homeLegY = odomY + (homeY - odomY) * range / distance;
+	}
+
+	if( !plannerInit(odomX, odomY, homeLegX, homeLegY, odomHeading) )
+		return false;
+
+	// the planner may have moved the goal off a wall
+	homeLegX = plannerCellCenterX(planGoal);
+	homeLegY = plannerCellCenterY(planGoal);
+
+	homeReplanTime = nSysTime;
+	homeLoadPath(true);
+	return true;
+} // end homePlanLeg
+
+//==========================================================
+//	homeLoadPath
+//	Hand the planned path to the path follower, keeping the
+//	current heading all the way
+//==========================================================
+void homeLoadPath(bool bNewLeg)
+{
+	pursuitClear();
+	for( int i = 0; i < planPathLength; i++ )
+		pursuitAddWaypoint(planPathX[i], planPathY[i], odomHeading);
+
+	if( bNewLeg )
+		pursuitStart(HOME_SPEED);
+	else
+		pursuitReplaced();
+} // end homeLoadPath
+
+//==========================================================
+//	homeWayBlocked
+//	true if the sonar looking where the robot is going sees
+//	something within HOME_FRONT_THRESHOLD
+//==========================================================
+bool homeWayBlocked()
+{
+	if( pursuitPathLength < 2 )
+		return false;
+
+	short next = pursuitSegment + 1;
+	float dx = pursuitPathX[next] - odomX;
+	float dy = pursuitPathY[next] - odomY;
+	if( dx == 0.0 && dy == 0.0 )
+		return false;
+
+	// direction of travel relative to the front of the robot
+	float travel = radiansToDegrees( atan2(dy, dx) ) - odomHeading;
+
+	short sonar = SONAR_FRONT;
+	float best 	= 360.0;
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		float off = abs( angleDifference(travel, SCAN_SONAR_OFFSET[i]) );
+		if( off < best )
+		{
+			best 	= off;
+			sonar = i;
+		}
+	}
+
+	return sonarThreat(sonar, HOME_FRONT_THRESHOLD);
+} // end homeWayBlocked
+
+//==========================================================
+//	homeFailedTry
+//	Count a leg that could not be planned or got no closer,
+//	give up after HOME_RETRY_MAX in a row
+//==========================================================
+void homeFailedTry()
+{
+	homeRetries += 1;
+	if( homeRetries < HOME_RETRY_MAX )
+		return;
+
+	writeDebugStreamLine("homeStep no way home after %d tries, %f in to go",
+												homeRetries, homeDistance());
+	bHomeFailed = true;
+	homeState 	= HOME_DONE;
+} // end homeFailedTry
+
+//==========================================================
+//	homeStep
+//	One control tick of the return home, every
+//	HOME_CONTROL_PERIOD. Returns the return home state.
+//==========================================================
+short homeStep()
+{
+	mapUpdateStep();
+
+	float distance 	= homeDistance();
+	float speed 		= 0.0;
+	float rotate 		= 0.0;
+
+	switch(homeState)
+	{
+	case HOME_PLAN:
+		moveStopReact();
+		if( distance < HOME_APPROACH_DISTANCE )
+		{
+			homeState = HOME_APPROACH;
+			break;
+		}
+
+		// a leg that ended no closer to home failed too
+		if( bHomeLegDriven )
+		{
+			bHomeLegDriven = false;
+			if( distance > homeLegDistance - HOME_PROGRESS_MIN )
+			{
+				homeFailedTry();
+				if( homeState == HOME_DONE )
+					break;
+			}
+			else
+				homeRetries = 0;
+		}
+
+		if( homePlanLeg() )
+		{
+			bHomeLegDriven 	= true;
+			homeLegDistance = distance;
+			homeState 			= HOME_DRIVE;
+			break;
+		}
+
+		homeFailedTry();
+		if( homeState != HOME_DONE )
+		{
+			writeDebugStreamLine("homeStep no way home, waiting");
+			homeStateTime = nSysTime;
+			homeState 		= HOME_BLOCKED;
+		}
+		break;
+
+	case HOME_BLOCKED:
+		moveStopReact();
+		if( nSysTime - homeStateTime > HOME_RETRY_PERIOD )
+			homeState = HOME_PLAN;
+		break;
+
+	case HOME_DRIVE:
+		if( distance < HOME_APPROACH_DISTANCE )
+		{
+			homeState = HOME_APPROACH;
+			break;
+		}
+
+		// EMERGENCY!!! COLLISION DETECTED
+		if( collisionDetected() || homeWayBlocked() )
+		{
+			moveStopReact();
+			homeState = HOME_PLAN;
+			break;
+		}
+
+		// repair the plan as the map fills in
+		if( nSysTime - homeReplanTime > HOME_REPLAN_PERIOD )
+		{
+			homeReplanTime = nSysTime;
+			if( !plannerReplan(odomX, odomY) )
+			{
+				moveStopReact();
+				homeState = HOME_PLAN;
+				break;
+			}
+			homeLoadPath(false);
+		}
+
+		// end of a leg, plan the next one
+		if( pursuitStep() )
+			homeState = HOME_PLAN;
+		break;
+
+	case HOME_APPROACH:
+		if( distance < HOME_TOLERANCE )
+		{
+			moveStopReact();
+			homeState = HOME_ALIGN;
+			break;
+		}
+
+		// straight at home, slowing down to a crawl
+		speed = HOME_APPROACH_KP * distance;
+		if( speed > HOME_APPROACH_SPEED_MAX )
+			speed = HOME_APPROACH_SPEED_MAX;
+		else if( speed < HOME_APPROACH_SPEED_MIN )
+			speed = HOME_APPROACH_SPEED_MIN;
+
+		moveFieldReact( speed * (homeX - odomX) / distance,
+										speed * (homeY - odomY) / distance,
+										odomHeading );
+		break;
+
+	case HOME_ALIGN:
+		// turned counter clockwise of the home heading: turn clockwise
+		rotate = MOVEMENT_HEADING_KP * angleDifference(odomHeading, homeHeading);
+		if( abs(angleDifference(odomHeading, homeHeading)) < HOME_HEADING_TOLERANCE )
+		{
+			moveStopReact();
+			writeDebugStreamLine("home in %d ms, %f in, %f deg off",
+														nSysTime - homeStartTime, distance,
+														angleDifference(odomHeading, homeHeading));
+			homeState = HOME_DONE;
+			break;
+		}
+
+		if( rotate > HOME_TURN_SPEED_MAX )
+			rotate = HOME_TURN_SPEED_MAX;
+		else if( rotate < -HOME_TURN_SPEED_MAX )
+			rotate = -HOME_TURN_SPEED_MAX;
+		else if( rotate > 0.0 && rotate < HOME_TURN_SPEED_MIN )
+			rotate = HOME_TURN_SPEED_MIN;
+		else if( rotate < 0.0 && rotate > -HOME_TURN_SPEED_MIN )
+			rotate = -HOME_TURN_SPEED_MIN;
+
+		moveMecanumReact( 0, 0, (int)rotate );
+		break;
+
+	case HOME_DONE:
+	default:
+		moveStopReact();
+		break;
+	} // end switch
+
+	return homeState;
+} // end homeStep
@@ -26,7 +26,22 @@
 
 
 //	THIS SECTION RESERVED FOR CUSTOM #include FILES
+#include "DebugLog.h"
 #include "HolonomicDrive.h"
+#include "LineFollower.h"
+#include "SonarTracker.h"
+#include "WallFollower.h"
+#include "SonarScan.h"
+#include "MapStore.h"
+#include "OccupancyGrid.h"
+#include "PathPlanner.h"
+#include "PathFollower.h"
+#include "Explorer.h"
+#include "ReturnHome.h"
+#include "TeleopRecorder.h"
+#include "Missions.h"
+#include "MissionRunner.h"
+#include "Telemetry.h"
 //#include "LCDManager.h"
 //#include "SentinalGlobals.h"
 
@@ -38,17 +53,61 @@
 int frontBumperPressed();
 
 // SYSTEM CHECKS
-void checkSystemComponents();
+task checkSystemComponents();
+void bootShowFailure();
 
 // MODES
-short remoteControlMode();
-short trackLineMode();
-short behavioralMode();
-short discoveryMode();
-short mappingMode();
-short defensiveMode();
+void remoteControlEnter();
+void remoteControlStep();
+float assistSpeedLimit(short sonar, float speed);
+void trackLineEnter();
+void behavioralEnter();
+void behavioralStep();
+void discoveryEnter();
+void discoveryStep();
+void showScanResultOnLCD();
+void mappingEnter();
+void showMapStatusOnLCD();
+void defensiveEnter();
+void defensiveStep();
+void exploreEnter();
+void showExploreStatusOnLCD();
+void wallFollowEnter();
+void showWallStatusOnLCD();
+void returnHomeEnter();
+void showHomeStatusOnLCD();
+void replayEnter();
+void showReplayStatusOnLCD();
+void missionEnter();
+void showMissionStatusOnLCD();
+short driveTestStep();
+float defensiveRepulsion(	short sonar,
+													int threshold,
+													short speed,
+													bool *bEscaping );
 
 // ADMIN
+void setSensorSamplingPlan(	int periodSonarFront,
+														int periodSonarRear,
+														int periodSonarRight,
+														int periodSonarLeft,
+														int periodLine,
+														int periodBumper );
+void applySensorSamplingPlan(short mode);
+bool sampleDue(short sensorGroup, long now);
+void modeRegister(	short mode,
+										string menuLabel,
+										string title,
+										int period,
+										int statusPeriod,
+										bool bHotSwitch );
+void modeRegistryInit();
+void modeEnter(short mode);
+short modeTick(short mode);
+void modeShowStatus(short mode);
+void modeExit(short mode);
+void menuTreeInit();
+void runModeScheduler();
 task monitorSensors();
 
 //===================================
@@ -62,54 +121,135 @@ task monitorSensors();
 //==========================================================
 int frontBumperPressed()
 {
-	writeDebugStreamLine("frontBumperPressed");
+	int pressed = SensorValue[bumpSwitchFront];
+	MAIN_EVENT(LOG_FRONT_BUMPER, pressed, 0, 0);
 
-	return SensorValue[bumpSwitchFront];
+	return pressed;
 }
 
 //==========================================================
 //	checkSystemComponents
-//
-//
+//	Runs once at boot, next to the menu: the battery, the
+//	IECs on the I2C chain, and an echo from every sonar.
+//	Gives the encoders and sonars up to BOOT_CHECK_TIMEOUT,
+//	then sets bootState for the scheduler to show a failure.
+//	A sonar reads -1 for no echo, in an open room too, so one
+//	valid reading anywhere in that time passes it. It only
+//	fails after BOOT_SONAR_SAMPLES readings and none valid.
+//	A sonar the sampling plan of the mode picked meanwhile has
+//	turned off is not checked.
 //==========================================================
-void checkSystemComponents()
+task checkSystemComponents()
 {
-	writeDebugStreamLine("checkSystemComponents");
+	MAIN_DEBUG("checkSystemComponents");
 
-	resetMotorEncoders();
+	long 	start 		= nSysTime;
+	long 	samplesStart[SONAR_COUNT];
+	bool 	bEcho[SONAR_COUNT];
+	bool 	bWaiting 	= true;
+
+	// a mode picked from the menu already counts on them
+	if( ROBOT_MODE == MODE_DECIDING )
+		resetMotorEncoders();
 
 	// Check the Battery Level
-	int nBatteryAverage = nAvgBatteryLevel;
-	writeDebugStreamLine("Average Battery Level: %d", nBatteryAverage);
 	int nBatteryLevel = nImmediateBatteryLevel;
-	writeDebugStreamLine("Immediate Battery Level: %d", nBatteryLevel);
+	MAIN_INFO("Immediate Battery Level: %d", nBatteryLevel);
+	if( nBatteryLevel < BOOT_BATTERY_MIN )
+		bootFailure |= BOOT_LOW_BATTERY;
+
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		bEcho[i] 				= false;
+		samplesStart[i] = sonarSampleCount[i];
+	}
 
-	// write to the sensor
-	clearLCDLine(0);
-	clearLCDLine(1);
-	setLCDPosition(0,0);
-	//displayNextLCDString("BATTERY: ");
-	displayLCDString(0,0, "BATTERY: ");
-	displayLCDNumber(0, 10, nBatteryLevel);
+	// monitorSensors samples the sonars in the menu plan
+	while( bWaiting && nSysTime - start < BOOT_CHECK_TIMEOUT )
+	{
+		bWaiting = ( nI2CDeviceCount < BOOT_IEC_COUNT );
+		for( int i = 0; i < SONAR_COUNT; i++ )
+		{
+			if( samplePeriod[SAMPLE_SONAR_FRONT + i] == SAMPLE_OFF )
+				continue;
+			if( sonarRawGlobal[i] >= 0 )
+				bEcho[i] = true;
+			if( !bEcho[i] )
+				bWaiting = true;
+		}
 
-	wait1Msec(3000);
+		if( bWaiting )
+			wait1Msec(BOOT_CHECK_PERIOD);
+	}
 
-	return;
-}
+	if( nI2CDeviceCount < BOOT_IEC_COUNT )
+		bootFailure |= BOOT_NO_ENCODERS;
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		if( !bEcho[i] && samplePeriod[SAMPLE_SONAR_FRONT + i] != SAMPLE_OFF &&
+				sonarSampleCount[i] - samplesStart[i] >= BOOT_SONAR_SAMPLES )
+			bootSonarSilent |= 1 << i;
+	}
+	if( bootSonarSilent != 0 )
+		bootFailure |= BOOT_NO_SONAR;
+
+	MAIN_INFO("checks done in %d ms: %d IECs, failures %d",
+												nSysTime - start, nI2CDeviceCount, bootFailure);
+	if( bootFailure != 0 )
+		bootState = BOOT_FAILED;
+	else
+		bootState = BOOT_PASSED;
+} // end checkSystemComponents
 
 //==========================================================
-//	remoteControlMode
-//
-//
+//	bootShowFailure
+//	The splash, with the first failed boot check under it.
+//	Stays until a button press redraws the menu.
 //==========================================================
-short remoteControlMode()
+void bootShowFailure()
 {
-	writeDebugStreamLine("runRemoteControlMode");
-
-	resetMotorEncoders();
+	lcdClearLine(0);
+	lcdClearLine(1);
+	lcdCenteredString(0, "SENTINAL");
 
-	populateLCDMenu("REMOTE MODE", EXIT );
+	if( (bootFailure & BOOT_LOW_BATTERY) != 0 )
+	{
+		lcdString(1, 0, "BATTERY:");
+		lcdNumber(1, 10, nImmediateBatteryLevel);
+	}
+	else if( (bootFailure & BOOT_NO_ENCODERS) != 0 )
+	{
+		lcdString(1, 0, "IECS FOUND:");
+		lcdNumber(1, 12, nI2CDeviceCount);
+	}
+	else
+	{
+		// SONAR_XXX order, to tell a dead sonar from open space
+		lcdString(1, 0, "NO ECHO:");
+		if( (bootSonarSilent & (1 << SONAR_FRONT)) != 0 )
+			lcdChar(1, 9, 'F');
+		if( (bootSonarSilent & (1 << SONAR_REAR)) != 0 )
+			lcdChar(1, 11, 'B');
+		if( (bootSonarSilent & (1 << SONAR_RIGHT)) != 0 )
+			lcdChar(1, 13, 'R');
+		if( (bootSonarSilent & (1 << SONAR_LEFT)) != 0 )
+			lcdChar(1, 15, 'L');
+	}
+} // end bootShowFailure
 
+//==========================================================
+//	remoteControlStep
+//	Drive the motors from the joystick, once
+//	Right stick drives the right wheels, left stick the left
+//	wheels; pushing a stick sideways traverses.
+//	The forward and strafe parts of the stick mix are limited
+//	toward an object (assistSpeedLimit) and only what is cut
+//	is taken off the wheels, so the wheel powers are the
+//	sticks' own when nothing is in the way. The recording
+//	keeps the forward, strafe and rotate parts only.
+//==========================================================
+void remoteControlStep()
+{
 	// Create and initialize local variables used for
 	// calculating each motor speed
 	int powerRF = 0;
@@ -118,52 +258,98 @@ short remoteControlMode()
 	int powerLR = 0;
 	int thresholdPower = 15;
 
-	while( true )
-	{
-		// Joystick: right stick moving forward/backward and right/left
-		powerRF = vexRT[Ch2] - vexRT[Ch1];
-		abs(powerRF) > thresholdPower ?
-		motor[motor_RF] = powerRF :
-		motor[motor_RF] = 0;
-
-		// Joystick: left stick moving forward/backward and right/left
-		powerLF = vexRT[Ch3] + vexRT[Ch4];
-		abs(powerLF) > thresholdPower ?
-		motor[motor_LF] = powerLF :
-		motor[motor_LF] = 0;
-
-		// Joystick: right stick moving forward/backward and right/left
-		powerRR  = vexRT[Ch2] + vexRT[Ch1];
-		abs(powerRR) > thresholdPower ?
-		motor[motor_RR] = powerRR :
-		motor[motor_RR] = 0;
-
-		// Joystick: left stick moving forward/backward and right/left
-		powerLR  = vexRT[Ch3] - vexRT[Ch4];
-		abs(powerLR) > thresholdPower ?
-		motor[motor_LR] = powerLR :
-		motor[motor_LR] = 0;
-
-		wait1Msec(PAUSETIME);
-
-		if( nLCDButtons == 1 || listenJoystick() == 1) // 1. left button pressed
-		{
-			wait1Msec(PAUSETIME); // slow things down a bit
-			return MODE_REMOTECONTROL;
-		}
-		else if( nLCDButtons == 2 || listenJoystick() == 2) // 2: Center button [EXIT] is pressed
-		{
-			wait1Msec(PAUSETIME); // slow things down a bit
-			return MODE_EXIT;
-		}
-	} // end while loop
+	// Joystick: right stick moving forward/backward and right/left
+	powerRF = vexRT[Ch2] - vexRT[Ch1];
+	if( abs(powerRF) <= thresholdPower )
+		powerRF = 0;
+
+	// Joystick: left stick moving forward/backward and right/left
+	powerLF = vexRT[Ch3] + vexRT[Ch4];
+	if( abs(powerLF) <= thresholdPower )
+		powerLF = 0;
+
+	// Joystick: right stick moving forward/backward and right/left
+	powerRR  = vexRT[Ch2] + vexRT[Ch1];
+	if( abs(powerRR) <= thresholdPower )
+		powerRR = 0;
+
+	// Joystick: left stick moving forward/backward and right/left
+	powerLR  = vexRT[Ch3] - vexRT[Ch4];
+	if( abs(powerLR) <= thresholdPower )
+		powerLR = 0;
+
+	// wheel powers to body speeds, see moveMecanumReact
+	float forward = ( powerLF + powerLR + powerRF + powerRR ) / 4.0;
+	float strafe 	= ( powerLF - powerLR - powerRF + powerRR ) / 4.0;
+	float rotate 	= ( powerLF + powerLR - powerRF - powerRR ) / 4.0;
+	float forwardAsked 	= forward;
+	float strafeAsked 	= strafe;
+
+	// only limit the speed toward an object, never away from it
+	if( forward > 0.0 && bFrontBumperPressed )
+		forward = 0.0;
+	else if( forward > 0.0 )
+		forward = assistSpeedLimit(SONAR_FRONT, forward);
+	else if( forward < 0.0 )
+		forward = -assistSpeedLimit(SONAR_REAR, -forward);
+
+	if( strafe > 0.0 )
+		strafe = assistSpeedLimit(SONAR_RIGHT, strafe);
+	else if( strafe < 0.0 )
+		strafe = -assistSpeedLimit(SONAR_LEFT, -strafe);
+
+	// take off each wheel only what the limits cut
+	float cutForward 	= forwardAsked - forward;
+	float cutStrafe 	= strafeAsked - strafe;
+
+	driveSetPower(	powerLF - (int)( cutForward + cutStrafe ),
+									powerLR - (int)( cutForward - cutStrafe ),
+									powerRF - (int)( cutForward - cutStrafe ),
+									powerRR - (int)( cutForward + cutStrafe ) );
+	recordCommand( (int)forward, (int)strafe, (int)rotate );
+} // end remoteControlStep
+
+//==========================================================
+//	assistSpeedLimit
+//	The speed (>= 0) allowed toward the object one sonar
+//	sees: the fastest speed whose stopping distance
+//	ASSIST_MARGIN + ASSIST_STOP_GAIN * speed still fits in the
+//	filtered range, so the robot slows down smoothly as it
+//	closes in and stops ASSIST_MARGIN short.
+//	speed is the requested speed toward that sonar's side.
+//==========================================================
+float assistSpeedLimit(short sonar, float speed)
+{
+	if( !bSonarTracking[sonar] )
+		return speed;
+
+	float allowed = ( sonarRangeGlobal[sonar] - ASSIST_MARGIN ) / ASSIST_STOP_GAIN;
+	if( allowed < 0.0 )
+		allowed = 0.0;
+
+	if( speed > allowed )
+		return allowed;
+
+	return speed;
+} // end assistSpeedLimit
+
+//==========================================================
+//	remoteControlEnter
+//	Start of remoteControlMode: drive with the joystick,
+//	remoteControlStep runs on every tick.
+//	The session is recorded for replayMode until the mode is
+//	left (see TeleopRecorder.h).
+//==========================================================
+void remoteControlEnter()
+{
+	MAIN_INFO("runRemoteControlMode");
 
-	return MODE_EXIT;
-} // end remoteControlMode
+	recordStart();
+} // end remoteControlEnter
 
 
 //==========================================================
-//	trackLineMode
+//	trackLineEnter
 //	The VEX Line Tracking Sensor allows the robot to tell objects or surfaces apart
 //	based on how dark or light they are. It shines a beam of infrared light out
 //	onto the object, and measures how much light is reflected back.
@@ -172,500 +358,1152 @@ short remoteControlMode()
 //	Darker objects reflect less light, and are indicated by higher numbers.
 //	Lighter objects reflect more light, and are indicated by lower numbers.
 //   LIGHTER <- 0   SensorValue[lineFollowerN]   -> 4095  DARKER
+//
+//	lineFollowerStep runs every LINE_CONTROL_PERIOD.
 //==========================================================
-short trackLineMode()
+void trackLineEnter()
 {
-	writeDebugStreamLine("trackLineMode");
-
-	resetMotorEncoders();
+	MAIN_INFO("trackLineMode");
 
 	// LineFollower Sensors, left to right, looking from back of vehicle
 	// 	lineFollower1  ... left
 	// 	lineFollower2  ... middle
 	//	lineFollower3 ... right
-	//writeDebugStreamLine("trackLine speed=%d", 30);
-
-	populateLCDMenu("TRACK LINE MODE ", EXIT);
 	showLineFollowerValuesOnLCD();
 
-	wait1Msec(1000);
+	lineFollowerReset();
+} // end trackLineEnter
+
+//==========================================================
+//	behavioralStep
+//	One control tick of the behavioral state machine.
+//
+//	IDLE					... motors stopped, watching the rear sonar
+//	THREAT_BEHIND	... threat seen behind, confirm it on the
+//									next tick so a single bad echo is ignored
+//	TURNING				... closed loop clockwise turn of
+//									BEHAVIOR_TURN_ANGLE, measured by the IECs,
+//									slowing down as it gets close
+//	FACING				... stopped and facing the threat, until
+//									nothing is in front any more
+//
+//	The turn gives up after BEHAVIORAL_TIME_LIMIT, so a stalled
+//	wheel cannot keep the robot turning forever.
+//==========================================================
+void behavioralStep()
+{
+	long now = nSysTime;
+	float remaining = 0.0;
+	float speed = 0.0;
 
-	while(true)
+	switch(behaviorState)
 	{
-		// Show the Line Follower Values to the LCD
-		showLineFollowerValuesOnLCD();
+	case BEHAVIOR_IDLE:
+		if( sonarThreat(SONAR_REAR, DEFENSE_REAR_THRESHOLD) )
+		{
+			behaviorThreatTime 	= now;
+			behaviorState 			= BEHAVIOR_THREAT_BEHIND;
+		}
+		break;
 
-		wait1Msec(100); // wait slightly
+	case BEHAVIOR_THREAT_BEHIND:
+		if( !sonarThreat(SONAR_REAR, DEFENSE_REAR_THRESHOLD) )
+		{
+			behaviorState = BEHAVIOR_IDLE;
+			break;
+		}
 
-		if( nLCDButtons == 1	|| listenJoystick() == 1 ) // 1. left button pressed
+		// rotate clockwise to face the object that approached from the rear
+		odometryUpdate();
+		behaviorTurnStart 	= now;
+		behaviorTurnHeading = odomHeading;
+		behaviorTurned 			= 0.0;
+		moveMecanumReact( 0, 0, SPEED_ROTATE_DEFAULT );
+		MAIN_INFO("behavioral reaction %d ms",
+													behaviorTurnStart - behaviorThreatTime);
+		behaviorState = BEHAVIOR_TURNING;
+		break;
+
+	case BEHAVIOR_TURNING:
+		odometryUpdate();
+
+		// add up the clockwise turn tick by tick, so a half
+		// turn does not wrap around to -180
+		behaviorTurned 			-= angleDifference(odomHeading, behaviorTurnHeading);
+		behaviorTurnHeading = odomHeading;
+
+		// degrees left to turn clockwise
+		remaining = BEHAVIOR_TURN_ANGLE - behaviorTurned;
+
+		if( remaining < BEHAVIOR_TURN_TOLERANCE )
 		{
-			stopAllMotors();
-			wait1Msec(PAUSETIME); // slow things down a bit
-			return MODE_TRACKLINE;
+			moveStopReact();
+			MAIN_INFO("behavioral turn %d ms, error %f deg",
+														now - behaviorTurnStart, -remaining);
+			behaviorState = BEHAVIOR_FACING;
 		}
-		else if( nLCDButtons == 2 || listenJoystick() == 2 )
+		else if( now - behaviorTurnStart > BEHAVIORAL_TIME_LIMIT )
 		{
-			stopAllMotors();
-			wait1Msec(PAUSETIME); // wait slightly
-			return MODE_EXIT;
+			// robot is chasing a tail that is not there
+			moveStopReact();
+			MAIN_INFO("behavioral turn timeout, %f deg left", remaining);
+			behaviorState = BEHAVIOR_IDLE;
 		}
+		else
+		{
+			// slow down near the target to limit overshoot
+			speed = BEHAVIOR_TURN_KP * remaining;
+			if( speed > SPEED_ROTATE_DEFAULT )
+				speed = SPEED_ROTATE_DEFAULT;
+			else if( speed < BEHAVIOR_TURN_SPEED_MIN )
+				speed = BEHAVIOR_TURN_SPEED_MIN;
+			moveMecanumReact( 0, 0, (int)speed );
+		}
+		break;
 
-		// Begin line following routine ...
-
-
-	} // end while loop
+	case BEHAVIOR_FACING:
+		// stay put while the object is in front
+		if( !sonarThreat(SONAR_FRONT, DEFENSE_FRONT_THRESHOLD) )
+		{
+			behaviorState = BEHAVIOR_IDLE;
+		}
+		break;
 
-	stopAllMotors();
-	return MODE_EXIT;
-} // end trackLineMode
+	default:
+		moveStopReact();
+		behaviorState = BEHAVIOR_IDLE;
+		break;
+	} // end switch
+} // end behavioralStep
 
 //==========================================================
-//	behavioralMode
+//	behavioralEnter
 //  If something approaches from the rear of the robot, once
 //  it crosses the DEFENSE_REAR_THRESHOLD distance value,
-// 	the robot will rotate clockwise until it detects another
-// 	object at its front that is less than DEFENSE_FRONT_THRESHOLD
+// 	the robot will turn around to face it.
+//  A fast approaching object triggers earlier, on its time to
+//  contact (see sonarThreat)
 //
+//	The state machine in behavioralStep runs every
+//	BEHAVIOR_CONTROL_PERIOD.
 //==========================================================
-short behavioralMode()
+void behavioralEnter()
 {
-	writeDebugStreamLine("behavioralMode");
+	MAIN_INFO("behavioralMode");
 
-	populateLCDMenu("BEHAVIORAL MODE ", EXIT);
-	wait1Msec(PAUSETIME);
+	behaviorState = BEHAVIOR_IDLE;
+} // end behavioralEnter
 
-	while( true ) // Primary While loop
+//==========================================================
+//	discoveryEnter
+//	Turn once in place while sampling all four sonars into
+//	the polar scan (see SonarScan.h), then stop and show the
+//	nearest object found.
+//
+//==========================================================
+void discoveryEnter()
+{
+	MAIN_INFO("discoveryMode");
+
+	scanSweepStart();
+	bDiscoverySweepDone = false;
+} // end discoveryEnter
+
+//==========================================================
+//	discoveryStep
+//	One tick of the sweep, every SCAN_CONTROL_PERIOD
+//==========================================================
+void discoveryStep()
+{
+	if( bDiscoverySweepDone )
+		return;
+
+	bDiscoverySweepDone = scanSweepStep();
+	if( bDiscoverySweepDone && bScanFailed )
 	{
-		showSonarValuesOnLCD();
-		//writeDebugStreamLine("SONAR: %d", sonarVal );
+		lcdClearLine(0);
+		lcdString(0, 0, "SCAN IEC ERROR");
+	}
+	else if( bDiscoverySweepDone )
+	{
+		showScanResultOnLCD();
+	}
+} // end discoveryStep
 
-		// React to objects to the rear of robot
-		// Secondary While Loop
-		while( sonarRearValGlobal < DEFENSE_REAR_THRESHOLD )
-		{
-			// rotate clockwise to face the object that approached from the rea
-			moveRotateClockWise( SPEED_ROTATE_DEFAULT, 0 );
+//==========================================================
+//	showScanResultOnLCD
+//	Show the direction and range of the nearest object
+//	in the scan on the first line of the LCD
+//==========================================================
+void showScanResultOnLCD()
+{
+	short nearestBin = -1;
+	short nearestRange = 0;
+	short range = 0;
 
-			// refresh the LCD
-			showSonarValuesOnLCD();
+	for( int i = 0; i < SCAN_BIN_COUNT; i++ )
+	{
+		range = scanRangeMedian(i);
+		if( range >= 0 && (nearestBin < 0 || range < nearestRange) )
+		{
+			nearestBin = i;
+			nearestRange = range;
+		}
+	}
 
-			// Listen for LCD and Joystick commands
-			if( nLCDButtons == 1 || listenJoystick() == 1) // 1. left button pressed
-			{
-				wait1Msec(PAUSETIME); // slow things down a bit
-				stopAllMotors();
-				return MODE_BEHAVIORAL; // return to choice menu system
-			}
-			else if( nLCDButtons == 2 || listenJoystick() == 2 )
-			{
-				wait1Msec(PAUSETIME); // wait a tenth of a second
-				stopAllMotors();
-				return MODE_EXIT; // exit program
-			}
+	lcdClearLine(0);
+	if( nearestBin < 0 )
+	{
+		lcdString(0, 0, "NOTHING FOUND");
+		return;
+	}
 
-			wait1Msec(PAUSETIME); // slow things down a bit
+	lcdString(0, 0, "Min: ");
+	lcdNumber(0, 5, nearestRange);
+	lcdString(0, 9, "@ ");
+	lcdNumber(0, 11, nearestBin * SCAN_BIN_DEGREES);
+} // end showScanResultOnLCD
 
-			// Object is no longer in rear of Robot
-			if( sonarRearValGlobal > DEFENSE_REAR_THRESHOLD )
-			{
-				writeDebugStreamLine("1 sonarRearValGlobal > DEFENSE_REAR_THRESHOLD");
+//==========================================================
+//	mappingEnter
+//	Drive with the joystick as in remoteControlMode while the
+//	occupancy grid (see OccupancyGrid.h) is updated from the
+//	sonars every MAP_UPDATE_PERIOD.
+//	The LCD shows the number of known cells and beams added.
+//
+//==========================================================
+void mappingEnter()
+{
+	MAIN_INFO("mappingMode");
 
-				// refresh the LCD
-				showSonarValuesOnLCD();
+	mapStart();
+} // end mappingEnter
 
-				wait1Msec(PAUSETIME); // slow things down a bit
+//==========================================================
+//	showMapStatusOnLCD
+//	Known cells and beams so far on the first line of the LCD
+//==========================================================
+void showMapStatusOnLCD()
+{
+	lcdClearLine(0);
+	lcdString(0, 0, "K:");
+	lcdNumber(0, 2, mapKnownCells());
+	lcdString(0, 8, "B:");
+	lcdNumber(0, 10, mapBeamCount);
+} // end showMapStatusOnLCD
 
-				// Listen for LCD and Joystick commands
-				if( nLCDButtons == 1 || listenJoystick() == 1) // 1. left button pressed
-				{
-					wait1Msec(PAUSETIME); // slow things down a bit
-					stopAllMotors();
-					return MODE_BEHAVIORAL; // return to choice menu system
-				}
-				else if( nLCDButtons == 2 || listenJoystick() == 2 )
-				{
-					wait1Msec(PAUSETIME); // wait a tenth of a second
-					stopAllMotors();
-					return MODE_EXIT; // exit program
-				}
+//==========================================================
+//	defensiveRepulsion
+//	How hard the object seen by one sonar pushes the robot
+//	away, as a motor speed (0 if there is no threat).
+//	Starts at the threshold (or on a short time to contact)
+//	and only lets go once the object is DEFENSE_HYSTERESIS
+//	inches past the threshold, so the robot does not chatter
+//	at the edge. The push grows from DEFENSE_SPEED_MIN_SCALE
+//	of speed at the release distance to full speed at contact.
+//==========================================================
+float defensiveRepulsion(	short sonar,
+													int threshold,
+													short speed,
+													bool *bEscaping )
+{
+	int releaseRange = threshold + DEFENSE_HYSTERESIS;
 
-				bool timerFlag = false;
+	if( sonarThreat(sonar, threshold) )
+	{
+		bEscaping[sonar] = true;
+	}
+	else if( sonarRangeGlobal[sonar] > releaseRange )
+	{
+		bEscaping[sonar] = false;
+	}
 
-				// Tertiary while loop
-				// continue rotating untill something is in front
-				// However, to prevent danger or rotating forever,
-				//	we start a Timer and after 3 seconds,
-				// robot will stop all motors
-				while( sonarFrontValGlobal > DEFENSE_FRONT_THRESHOLD )
-				{
-					writeDebugStreamLine("sonarFrontValGlobal > DEFENSE_FRONT_THRESHOLD");
-
-					// Enage timer mechanism to make sure we
-					// stop this while loop in 3 seconds.
-					if( timerFlag == false )
-					{
-						clearTimer(T1);
-						timerFlag = true;
-					}
-
-					// if timerFlag has been set, then Timer has been
-					// counting.
-					// If more than 3 seconds has elapsed, then stop
-					// all motors and exit loop because
-					// robot is chasing a tail that is not there
-					if( timerFlag )
-					{
-						if( time1[T1] > BEHAVIORAL_TIME_LIMIT )
-						{
-							stopAllMotors();
-							// break out of Tertiary while loop
-							break;
-						}
-					}
-					// refresh the LCD
-					showSonarValuesOnLCD();
-					wait1Msec(PAUSETIME); // slow things down a bit
-
-					// Listen for LCD and Joystick commands
-					if( nLCDButtons == 1 || listenJoystick() == 1) // 1. left button pressed
-					{
-						wait1Msec(PAUSETIME); // slow things down a bit
-						stopAllMotors();
-						return MODE_BEHAVIORAL; // return to choice menu system
-					}
-					else if( nLCDButtons == 2 || listenJoystick() == 2 )
-					{
-						wait1Msec(PAUSETIME); // wait a tenth of a second
-						stopAllMotors();
-						return MODE_EXIT; // exit program
-					}
-				} // end Tertiary while loop because object is now in front
-
-			} // end if
-
-		} // end Secondary while loop
-
-		// stop motors
-		stopAllMotors();
-
-		wait1Msec(PAUSETIME);
-
-		// Listen for LCD and Joystick commands
-		if( nLCDButtons == 1 || listenJoystick() == 1) // 1. left button pressed
-		{
-			wait1Msec(PAUSETIME); // slow things down a bit
-			stopAllMotors();
-			return MODE_BEHAVIORAL; // return to choice menu system
-		}
-		else if( nLCDButtons == 2 || listenJoystick() == 2 )
-		{
-			wait1Msec(PAUSETIME); // wait a tenth of a second
-			stopAllMotors();
-			return MODE_EXIT; // exit program
-		}
+	if( !bEscaping[sonar] )
+		return 0.0;
 
-	} // end Primary while loop
+	float proximity = 1.0 - sonarRangeGlobal[sonar] / releaseRange;
+	if( proximity < 0.0 )
+		proximity = 0.0;
+	else if( proximity > 1.0 )
+		proximity = 1.0;
 
-	stopAllMotors();
-	return MODE_EXIT;
-} // end behavioralMode
+	return speed * ( DEFENSE_SPEED_MIN_SCALE
+									+ (1.0 - DEFENSE_SPEED_MIN_SCALE) * proximity );
+} // end defensiveRepulsion
 
 //==========================================================
-//	discoveryMode
+//	defensiveEnter
+//
+// 	Robot will move away from objects that are less
+//  than the threshold distances for
+//	DEFENSE_FRONT_THRESHOLD
+//	DEFENSE_REAR_THRESHOLD
+//	DEFENSE_RIGHT_THRESHOLD
+//	DEFENSE_LEFT_THRESHOLD
+//  or that are closing in fast enough to reach the robot
+//  within DEFENSE_TTC_THRESHOLD
 //
+//	Every sonar that sees a threat pushes the robot away
+//	from it. The pushes are added into one escape vector and
+//	sent to the motors as a single command, so an object at
+//	the front and one at the right make the robot escape
+//	diagonally to the rear left.
+//	Objects on opposite sides cancel out, and the robot
+//	holds still: what is left of the push on each axis is
+//	dropped when it is under DEFENSE_DEADBAND, so two pushes
+//	that nearly cancel do not make the robot creep.
 //
 //==========================================================
-short discoveryMode()
+void defensiveEnter()
 {
-	writeDebugStreamLine("discoveryMode");
+	MAIN_INFO("defensiveMode");
 
-	populateLCDMenu("DISCOVERY MODE  ", EXIT);
+	showSonarValuesOnLCD();
 
-	wait1Msec(1000); // wait a tenth of a second
+	// assume nothing detected on any side.
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		bDefenseEscaping[i] = false;
+	}
+} // end defensiveEnter
 
-	/*  Enter an infinite loop and gather data from the sonar.
-	Show the sonar data on the LCD.
-	sonarFront
-	*/
-	while(true)
+//==========================================================
+//	defensiveStep
+//	Analyze if objects are too close to any side of the
+//	robot and escape, every DEFENSE_CONTROL_PERIOD
+//==========================================================
+void defensiveStep()
+{
+	float escapeForward = 0.0;
+	float escapeStrafe 	= 0.0;
+
+	escapeForward -= defensiveRepulsion(SONAR_FRONT, DEFENSE_FRONT_THRESHOLD,
+																			SPEED_REAR_DEFAULT, bDefenseEscaping);
+	escapeForward += defensiveRepulsion(SONAR_REAR, DEFENSE_REAR_THRESHOLD,
+																			SPEED_FRONT_DEFAULT, bDefenseEscaping);
+	escapeStrafe 	-= defensiveRepulsion(SONAR_RIGHT, DEFENSE_RIGHT_THRESHOLD,
+																			SPEED_LEFT_DEFAULT, bDefenseEscaping);
+	escapeStrafe 	+= defensiveRepulsion(SONAR_LEFT, DEFENSE_LEFT_THRESHOLD,
+																			SPEED_RIGHT_DEFAULT, bDefenseEscaping);
+
+	// opposite pushes never cancel exactly
+	if( abs(escapeForward) < DEFENSE_DEADBAND )
+		escapeForward = 0.0;
+	if( abs(escapeStrafe) < DEFENSE_DEADBAND )
+		escapeStrafe = 0.0;
+
+	// one motor command per tick
+	if( escapeForward == 0.0 && escapeStrafe == 0.0 )
+	{
+		// nothing to escape from, or boxed in
+		moveStopReact();
+	}
+	else
 	{
-		clearLCDLine(0);
-		displayLCDString(0,0,"SONAR:");
+		moveMecanumReact( (int)escapeForward, (int)escapeStrafe, 0 );
+	}
+} // end defensiveStep
 
-		// Put the Sonar Value to the LCD (inches)
-		showSonarValuesOnLCD();
-		//writeDebugStreamLine("SONAR: %d", sonarVal );
 
-		wait1Msec(PAUSETIME); // wait a tenth of a second
+//==========================================================
+//	exploreEnter
+//	Explore and map the area on its own: turn to look around,
+//	drive to the most promising frontier between known free
+//	space and unknown space, and repeat until nothing is left
+//	to explore (see Explorer.h).
+//	The LCD shows goals reached and the area mapped per minute.
+//
+//==========================================================
+void exploreEnter()
+{
+	MAIN_INFO("exploreMode");
 
-		if( nLCDButtons == 1 || listenJoystick() == 1 ) // 1. left button pressed
-		{
-			wait1Msec(PAUSETIME); // slow things down a bit
-			return MODE_DISCOVERY;
-		}
-		else if( nLCDButtons == 2 || listenJoystick() == 2 )
-		{
-			wait1Msec(PAUSETIME); // wait a tenth of a second
-			return MODE_EXIT;
-		}
-	} // end while loop
+	exploreStart();
+} // end exploreEnter
 
-	return MODE_EXIT;
-} // end discoveryMode
+//==========================================================
+//	showExploreStatusOnLCD
+//	Goals reached and square meters mapped per minute on the
+//	first line of the LCD
+//==========================================================
+void showExploreStatusOnLCD()
+{
+	lcdClearLine(0);
+	if( exploreState == EXPLORE_DONE )
+		lcdString(0, 0, "DONE");
+	else
+	{
+		lcdString(0, 0, "G:");
+		lcdNumber(0, 2, exploreGoalCount);
+	}
+	lcdString(0, 6, "m2/m:");
+	lcdNumber(0, 11, (int)( exploreAreaPerMinute() * 10 ));
+} // end showExploreStatusOnLCD
 
 //==========================================================
-//	mappingMode
-//
-//
+//	wallFollowEnter
+//	Patrol along the wall on the nearer side, holding
+//	WALL_DISTANCE from it by strafing while driving forward
+//	(see WallFollower.h). wallFollowerStep runs every
+//	WALL_CONTROL_PERIOD.
+//	The LCD shows the distance error and the speed.
 //==========================================================
-short mappingMode()
+void wallFollowEnter()
 {
-	writeDebugStreamLine("mappingMode");
+	MAIN_INFO("wallFollowMode");
 
-	populateLCDMenu("MAPPING MODE    ", EXIT);
+	wallFollowerReset();
+} // end wallFollowEnter
 
-	while( true )
+//==========================================================
+//	showWallStatusOnLCD
+//	Wall side and range, rms error in tenths of an inch and
+//	speed in inches per second on the first line of the LCD
+//==========================================================
+void showWallStatusOnLCD()
+{
+	lcdClearLine(0);
+	if( wallSide == SONAR_LEFT )
+		lcdString(0, 0, "L");
+	else
+		lcdString(0, 0, "R");
+	lcdNumber(0, 1, (int)sonarRangeGlobal[wallSide]);
+	lcdString(0, 5, "E");
+	lcdNumber(0, 6, (int)( wallErrorRMS() * 10 ));
+	lcdString(0, 10, "V");
+	lcdNumber(0, 11, (int)wallSpeed());
+} // end showWallStatusOnLCD
+
+//==========================================================
+//	returnHomeEnter
+//	Go back to where the last mode picked from the menu
+//	started, around whatever the sonars see on the way, then
+//	line up with the heading the robot had there
+//	(see ReturnHome.h).
+//	The LCD shows the state and the distance left.
+//==========================================================
+void returnHomeEnter()
+{
+	MAIN_INFO("returnHomeMode");
+
+	homeStart();
+} // end returnHomeEnter
+
+//==========================================================
+//	showHomeStatusOnLCD
+//	Return home state and inches to go on the first line of
+//	the LCD
+//==========================================================
+void showHomeStatusOnLCD()
+{
+	lcdClearLine(0);
+	switch(homeState)
 	{
-		wait1Msec(PAUSETIME);
+		case HOME_DRIVE:			lcdString(0, 0, "DRIVE");		break;
+		case HOME_APPROACH:		lcdString(0, 0, "CLOSE IN");	break;
+		case HOME_ALIGN:			lcdString(0, 0, "ALIGN");		break;
+		case HOME_DONE:
+			if( bHomeFailed )
+				lcdString(0, 0, "NO WAY");
+			else
+				lcdString(0, 0, "HOME");
+			break;
+		case HOME_BLOCKED:		lcdString(0, 0, "BLOCKED");	break;
+		default:							lcdString(0, 0, "PLAN");			break;
+	} // end switch
+	lcdNumber(0, 10, (int)homeDistance());
+	lcdString(0, 14, "in");
+} // end showHomeStatusOnLCD
 
-		if( nLCDButtons == 1 || listenJoystick() == 1 ) // 1. left button pressed
-		{
-			wait1Msec(PAUSETIME); // slow things down a bit
-			return MODE_MAPPING;
-		}
-		else if( nLCDButtons == 2 || listenJoystick() == 2 )
-		{
-			wait1Msec(PAUSETIME); // wait a tenth of a second
-			return MODE_EXIT;
-		}
-	} // end while loop
+//==========================================================
+//	replayEnter
+//	Drive the last remoteControlMode session again, starting
+//	from where the robot is now, corrected from odometry
+//	(see TeleopRecorder.h).
+//	The LCD shows the seconds played and the last error.
+//==========================================================
+void replayEnter()
+{
+	MAIN_INFO("replayMode");
 
-	stopAllMotors();
-	return MODE_EXIT;
+	replayStart();
+} // end replayEnter
 
-} // end mappingMode
+//==========================================================
+//	showReplayStatusOnLCD
+//	Seconds into the replay and inches off the recording on
+//	the first line of the LCD
+//==========================================================
+void showReplayStatusOnLCD()
+{
+	lcdClearLine(0);
+	if( bReplayDone )
+		lcdString(0, 0, "DONE");
+	else
+		lcdNumber(0, 0, (int)( replayClock * RECORD_TIME_UNIT / 1000 ));
+	lcdString(0, 5, "s");
+	lcdNumber(0, 10, (int)replayErrorLast);
+	lcdString(0, 14, "in");
+} // end showReplayStatusOnLCD
 
 //==========================================================
-//	defensiveMode
-//
-// 	Robot will move away from objects that are less
-//  than the threshold distances for
-//	DEFENSE_FRONT_THRESHOLD
-//	DEFENSE_REAR_THRESHOLD
-//	DEFENSE_RIGHT_THRESHOLD
-//	DEFENSE_LEFT_THRESHOLD
-//
+//	missionEnter
+//	Run the selected mission from Missions.h, one step of
+//	the interpreter per tick (see MissionRunner.h). A
+//	SENTINAL_BENCHMARK build times the interpreter standing
+//	still first.
+//	The LCD shows the state and the instruction running.
 //==========================================================
-short defensiveMode()
+void missionEnter()
 {
-	writeDebugStreamLine("defensiveMode");
+	MAIN_INFO("missionMode");
 
-	// declare boolean alert variables
-	// assume nothing detected on any side.
-	bool bObjectFront = false;
-	bool bObjectRear 	= false;
-	bool bObjectRight = false;
-	bool bObjectLeft 	= false;
+#ifdef SENTINAL_BENCHMARK
+	missionBenchmark(MISSION_BENCHMARK_STEPS);
+#endif
+	missionStart(missionSelected);
+} // end missionEnter
 
-	populateLCDMenu("DEFENSIVE MODE  ", EXIT);
-	showSonarValuesOnLCD();
+//==========================================================
+//	showMissionStatusOnLCD
+//	Mission state and the byte of the instruction running on
+//	the first line of the LCD
+//==========================================================
+void showMissionStatusOnLCD()
+{
+	lcdClearLine(0);
+	switch(missionState)
+	{
+		case MISSION_RUNNING:	lcdString(0, 0, "RUN");		break;
+		case MISSION_FAILED:	lcdString(0, 0, "FAILED");	break;
+		default:							lcdString(0, 0, "DONE");		break;
+	} // end switch
+	lcdString(0, 9, "@");
+	lcdNumber(0, 10, missionPC);
+} // end showMissionStatusOnLCD
+
+//==========================================================
+//	driveTestStep
+//	Run the driving tests once, they block until done, then
+//	go back to the menu. A SENTINAL_BENCHMARK build times the
+//	drive logging first.
+//==========================================================
+short driveTestStep()
+{
+#ifdef SENTINAL_BENCHMARK
+	// standing still, before anything moves
+	driveLogBenchmark(DRIVE_BENCHMARK_PASSES);
+#endif
+
+	runDrivingTestBasic(	40, //SPEED_FRONT_DEFAULT,
+												0, // run time
+												2000, // pauses
+												true, true, true, true,
+												//true, false, false, false,
+												12.0 ); // distance inches
+	runPathFollowerTest(40, 24.0);
+
+	return MODE_DECIDING;
+} // end driveTestStep
+
+//==========================================================
+//	setSensorSamplingPlan
+//	Set the read period in ms of every sensor group.
+//	SAMPLE_OFF stops reading that group, a sonar turned off
+//	loses its target.
+//	The next tick of monitorSensors reads every enabled
+//	group immediately.
+//==========================================================
+void setSensorSamplingPlan(	int periodSonarFront,
+														int periodSonarRear,
+														int periodSonarRight,
+														int periodSonarLeft,
+														int periodLine,
+														int periodBumper )
+{
+	samplePeriod[SAMPLE_SONAR_FRONT] 	= periodSonarFront;
+	samplePeriod[SAMPLE_SONAR_REAR] 	= periodSonarRear;
+	samplePeriod[SAMPLE_SONAR_RIGHT] 	= periodSonarRight;
+	samplePeriod[SAMPLE_SONAR_LEFT] 	= periodSonarLeft;
+	samplePeriod[SAMPLE_LINE] 				= periodLine;
+	samplePeriod[SAMPLE_BUMPER] 			= periodBumper;
+
+	for( int i = 0; i < SAMPLE_COUNT; i++ )
+	{
+		sampleTimeLast[i] = nSysTime - samplePeriod[i];
+	}
+
+	// a sonar that is not read any more has no range rate
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		if( samplePeriod[SAMPLE_SONAR_FRONT + i] == SAMPLE_OFF )
+			sonarTrackerForget(i);
+	}
+} // end setSensorSamplingPlan
+
+//==========================================================
+//	applySensorSamplingPlan
+//	Only read the sensors the mode uses, and read those faster.
+//	Call when switching modes.
+//	Faster has a ceiling for the sonars: one new reading per
+//	SONAR_ECHO_PERIOD. A shorter sonar period below only
+//	cuts the delay to a new reading, it adds no readings.
+//	The bumper is never turned off, it is the collision safety
+//	check for all the moveXXX functions.
+//==========================================================
+void applySensorSamplingPlan(short mode)
+{
+	MAIN_DEBUG("applySensorSamplingPlan mode=%d", mode);
+
+	switch(mode)
+	{
+		//																front rear right left line bumper
+		case MODE_TRACKLINE:
+			// line follower needs fast line data, no sonar
+			setSensorSamplingPlan(SAMPLE_OFF, SAMPLE_OFF, SAMPLE_OFF, SAMPLE_OFF, 5, 10);
+			break;
+		case MODE_BEHAVIORAL:
+			// threats come from behind, then wait for them in front
+			setSensorSamplingPlan(25, BEHAVIOR_CONTROL_PERIOD,
+														SAMPLE_OFF, SAMPLE_OFF, SAMPLE_OFF, 10);
+			break;
+		case MODE_DEFENSIVE:
+			setSensorSamplingPlan(DEFENSE_CONTROL_PERIOD, DEFENSE_CONTROL_PERIOD,
+														DEFENSE_CONTROL_PERIOD, DEFENSE_CONTROL_PERIOD,
+														SAMPLE_OFF, 10);
+			break;
+		case MODE_DISCOVERY:
+			setSensorSamplingPlan(SCAN_CONTROL_PERIOD, SCAN_CONTROL_PERIOD,
+														SCAN_CONTROL_PERIOD, SCAN_CONTROL_PERIOD,
+														SAMPLE_OFF, 10);
+			break;
+		case MODE_WALLFOLLOW:
+			// corners come from the front, the wall is on one side
+			setSensorSamplingPlan(WALL_CONTROL_PERIOD, SAMPLE_OFF,
+														WALL_CONTROL_PERIOD, WALL_CONTROL_PERIOD,
+														SAMPLE_OFF, 10);
+			break;
+		case MODE_MAPPING:
+		case MODE_EXPLORE:
+		case MODE_RETURNHOME:
+			setSensorSamplingPlan(MAP_UPDATE_PERIOD, MAP_UPDATE_PERIOD,
+														MAP_UPDATE_PERIOD, MAP_UPDATE_PERIOD,
+														SAMPLE_OFF, 10);
+			break;
+		case MODE_REMOTECONTROL:
+			// the sonars keep the driver from hitting things
+			setSensorSamplingPlan(25, 25, 25, 25, SAMPLE_OFF, 10);
+			break;
+		case MODE_DRIVETEST:
+		case MODE_REPLAY:
+		case MODE_MISSION:
+			setSensorSamplingPlan(50, 50, 50, 50, SAMPLE_OFF, 10);
+			break;
+		default:
+			// menus and anything unknown, read everything
+			setSensorSamplingPlan(50, 50, 50, 50, 50, 10);
+			break;
+	} // end switch
+} // end applySensorSamplingPlan
+
+//==========================================================
+//	sampleDue
+//	true if the sensor group is enabled and its period
+//	has elapsed. Marks the group as read.
+//==========================================================
+bool sampleDue(short sensorGroup, long now)
+{
+	if( samplePeriod[sensorGroup] == SAMPLE_OFF )
+		return false;
+
+	if( now - sampleTimeLast[sensorGroup] < samplePeriod[sensorGroup] )
+		return false;
+
+	sampleTimeLast[sensorGroup] = now;
+	return true;
+} // end sampleDue
+
+//==========================================================
+//	modeRegister
+//	Fill in the registry entry of one mode
+//		menuLabel			... question shown in the menu
+//		title					... first LCD line while the mode runs
+//		period				... ms between ticks
+//		statusPeriod	... ms between LCD refreshes, 0 for none
+//		bHotSwitch		... can take over from another mode while
+//										the robot moves
+//==========================================================
+void modeRegister(	short mode,
+										string menuLabel,
+										string title,
+										int period,
+										int statusPeriod,
+										bool bHotSwitch )
+{
+	modeMenuLabel[mode] 		= menuLabel;
+	modeTitle[mode] 				= title;
+	modePeriod[mode] 				= period;
+	modeStatusPeriod[mode] 	= statusPeriod;
+	bModeHotSwitch[mode] 		= bHotSwitch;
+} // end modeRegister
+
+//==========================================================
+//	modeRegistryInit
+//	The table of modes, menuTreeInit arranges them in the menu
+//==========================================================
+void modeRegistryInit()
+{
+	//						mode								menu							title									tick ms									LCD ms	hot switch
+	modeRegister(	MODE_REMOTECONTROL, "REMOTE CONTROL?", "REMOTE MODE", 			20, 										0, 			true );
+	modeRegister(	MODE_DRIVETEST, 		"DRIVE TEST?", 		"DRIVE TEST", 				20, 										0, 			false );
+	modeRegister(	MODE_TRACKLINE, 		"TRACK LINE?", 		"TRACK LINE MODE ", 	LINE_CONTROL_PERIOD, 		100, 		true );
+	modeRegister(	MODE_BEHAVIORAL, 		"BEHAVIORAL?", 		"BEHAVIORAL MODE ", 	BEHAVIOR_CONTROL_PERIOD, 100, 		true );
+	modeRegister(	MODE_DISCOVERY, 		"DISCOVERY?", 		"DISCOVERY MODE  ", 	SCAN_CONTROL_PERIOD, 		100, 		true );
+	modeRegister(	MODE_MAPPING, 			"MAPPING?", 			"MAPPING MODE    ", 	MAP_UPDATE_PERIOD, 			300, 		true );
+	modeRegister(	MODE_DEFENSIVE, 		"DEFENSIVE?", 		"DEFENSIVE MODE  ", 	DEFENSE_CONTROL_PERIOD, 100, 		true );
+	modeRegister(	MODE_EXPLORE, 			"EXPLORE?", 			"EXPLORE MODE    ", 	EXPLORE_CONTROL_PERIOD, 300, 		true );
+	modeRegister(	MODE_WALLFOLLOW, 		"WALL FOLLOW?", 	"WALL FOLLOW MODE", 	WALL_CONTROL_PERIOD, 		200, 		true );
+	modeRegister(	MODE_RETURNHOME, 		"RETURN HOME?", 	"RETURN HOME MODE", 	HOME_CONTROL_PERIOD, 		200, 		true );
+	modeRegister(	MODE_REPLAY, 				"REPLAY?", 				"REPLAY MODE     ", 	RECORD_TIME_UNIT, 			200, 		false );
+	modeRegister(	MODE_MISSION, 			"MISSION?", 			"MISSION MODE    ", 	MISSION_CONTROL_PERIOD, 200, 		false );
+} // end modeRegistryInit
+
+//==========================================================
+//	menuTreeInit
+//	The LCD menu, see LCDManager.h. Mode entries take their
+//	label from the mode registry.
+//==========================================================
+void menuTreeInit()
+{
+	menuNodeCount = 0;
+	menuAdd( MENU_NONE, "SENTINAL", MENU_ACTION_SUBMENU, 0 );
+
+	short drive = menuAdd( MENU_ROOT, "DRIVE >", MENU_ACTION_SUBMENU, 0 );
+	menuAdd( drive, modeMenuLabel[MODE_REMOTECONTROL], 	MENU_ACTION_MODE, MODE_REMOTECONTROL );
+	menuAdd( drive, modeMenuLabel[MODE_MAPPING], 				MENU_ACTION_MODE, MODE_MAPPING );
+	menuAdd( drive, modeMenuLabel[MODE_REPLAY], 				MENU_ACTION_MODE, MODE_REPLAY );
+	menuAdd( drive, modeMenuLabel[MODE_DRIVETEST], 			MENU_ACTION_MODE, MODE_DRIVETEST );
+	menuAdd( drive, "DUMP RECORD", 										MENU_ACTION_DUMP, 0 );
+
+	short autonomous = menuAdd( MENU_ROOT, "AUTONOMOUS >", MENU_ACTION_SUBMENU, 0 );
+	menuAdd( autonomous, modeMenuLabel[MODE_TRACKLINE], 	MENU_ACTION_MODE, MODE_TRACKLINE );
+	menuAdd( autonomous, modeMenuLabel[MODE_BEHAVIORAL], 	MENU_ACTION_MODE, MODE_BEHAVIORAL );
+	menuAdd( autonomous, modeMenuLabel[MODE_DISCOVERY], 	MENU_ACTION_MODE, MODE_DISCOVERY );
+	menuAdd( autonomous, modeMenuLabel[MODE_DEFENSIVE], 	MENU_ACTION_MODE, MODE_DEFENSIVE );
+	menuAdd( autonomous, modeMenuLabel[MODE_EXPLORE], 		MENU_ACTION_MODE, MODE_EXPLORE );
+	menuAdd( autonomous, modeMenuLabel[MODE_WALLFOLLOW], 	MENU_ACTION_MODE, MODE_WALLFOLLOW );
+	menuAdd( autonomous, modeMenuLabel[MODE_RETURNHOME], 	MENU_ACTION_MODE, MODE_RETURNHOME );
+
+	short missions = menuAdd( MENU_ROOT, "MISSIONS >", MENU_ACTION_SUBMENU, 0 );
+	menuAdd( missions, "DRIVE TEST", 	MENU_ACTION_MISSION, MISSION_DRIVE_TEST );
+	menuAdd( missions, "PATROL", 			MENU_ACTION_MISSION, MISSION_PATROL );
+
+	menuAdd( MENU_ROOT, "STOP MODE", 	MENU_ACTION_STOP, 0 );
+	menuAdd( MENU_ROOT, "EXIT", 			MENU_ACTION_EXIT, 0 );
+
+	menuCursor = menuChild[MENU_ROOT];
+} // end menuTreeInit
+
+//==========================================================
+//	modeEnter
+//	Enter hook: show the title and set the mode up
+//==========================================================
+void modeEnter(short mode)
+{
+	lcdClearLine(0);
+	lcdCenteredString(0, modeTitle[mode]);
+
+	switch(mode)
+	{
+		case MODE_REMOTECONTROL:	remoteControlEnter();		break;
+		case MODE_TRACKLINE:			trackLineEnter();				break;
+		case MODE_BEHAVIORAL:			behavioralEnter();			break;
+		case MODE_DISCOVERY:			discoveryEnter();				break;
+		case MODE_MAPPING:				mappingEnter();					break;
+		case MODE_DEFENSIVE:			defensiveEnter();				break;
+		case MODE_EXPLORE:				exploreEnter();					break;
+		case MODE_WALLFOLLOW:			wallFollowEnter();			break;
+		case MODE_RETURNHOME:			returnHomeEnter();			break;
+		case MODE_REPLAY:					replayEnter();					break;
+		case MODE_MISSION:				missionEnter();					break;
+		default:																					break;
+	} // end switch
+} // end modeEnter
+
+//==========================================================
+//	modeTick
+//	Tick hook: one control step of the mode.
+//	Returns the mode to run next, the same mode to go on.
+//==========================================================
+short modeTick(short mode)
+{
+	switch(mode)
+	{
+		case MODE_REMOTECONTROL:	remoteControlStep();		break;
+		case MODE_DRIVETEST:			return driveTestStep();
+		case MODE_TRACKLINE:			lineFollowerStep();			break;
+		case MODE_BEHAVIORAL:			behavioralStep();				break;
+		case MODE_DISCOVERY:			discoveryStep();				break;
+		case MODE_MAPPING:
+			remoteControlStep();
+			mapUpdateStep();
+			break;
+		case MODE_DEFENSIVE:			defensiveStep();				break;
+		case MODE_EXPLORE:				exploreStep();					break;
+		case MODE_WALLFOLLOW:			wallFollowerStep();			break;
+		case MODE_RETURNHOME:			homeStep();							break;
+		case MODE_REPLAY:					replayStep();						break;
+		case MODE_MISSION:				missionStep();					break;
+		default:									return MODE_EXIT;
+	} // end switch
+
+	return mode;
+} // end modeTick
+
+//==========================================================
+//	modeShowStatus
+//	Refresh the first line of the LCD while the mode runs
+//==========================================================
+void modeShowStatus(short mode)
+{
+	switch(mode)
+	{
+		case MODE_TRACKLINE:			showLineFollowerValuesOnLCD();	break;
+		case MODE_BEHAVIORAL:			showSonarValuesOnLCD();					break;
+		case MODE_DISCOVERY:
+			// the result stays up once the sweep is done
+			if( !bDiscoverySweepDone )
+				showSonarValuesOnLCD();
+			break;
+		case MODE_MAPPING:				showMapStatusOnLCD();						break;
+		case MODE_DEFENSIVE:			showSonarValuesOnLCD();					break;
+		case MODE_EXPLORE:				showExploreStatusOnLCD();				break;
+		case MODE_WALLFOLLOW:			showWallStatusOnLCD();					break;
+		case MODE_RETURNHOME:			showHomeStatusOnLCD();					break;
+		case MODE_REPLAY:					showReplayStatusOnLCD();				break;
+		case MODE_MISSION:				showMissionStatusOnLCD();				break;
+		default:																									break;
+	} // end switch
+} // end modeShowStatus
+
+//==========================================================
+//	modeExit
+//	Exit hook: report on the run.
+//	The motors are left alone, the scheduler decides whether
+//	the next mode ramps from them or they stop.
+//==========================================================
+void modeExit(short mode)
+{
+	switch(mode)
+	{
+		case MODE_REMOTECONTROL:	recordStop();						break;
+		case MODE_TRACKLINE:			lineFollowerReport();		break;
+		case MODE_WALLFOLLOW:			wallFollowerReport();		break;
+		case MODE_MISSION:
+			// left before the END, report how far it got
+			if( missionState == MISSION_RUNNING )
+				missionReport();
+			break;
+		default:																					break;
+	} // end switch
+} // end modeExit
+
+//==========================================================
+//	runModeScheduler
+//	The one control loop of the program.
+//	Ticks the running mode every modePeriod, refreshes its LCD
+//	status every modeStatusPeriod and hands the next button
+//	press queued by inputMonitor to the menu engine every
+//	MODE_INPUT_PERIOD.
+//	A long press of the right button goes to the next
+//	telemetry page (Telemetry.h), which is then drawn every
+//	TELEMETRY_PERIOD in place of the status.
+//	The menu can be browsed while a mode runs; picking an
+//	entry (see menuTreeInit)
+//		a mode				... switches to it, picking the running
+//										mode again starts it over
+//		a mission			... runs it in missionMode
+//		STOP MODE			... stops the mode, back to the menu
+//		DUMP RECORD		... starts the recordDump task, the mode
+//										keeps running
+//		EXIT					... ends the program
+//	A tick returns the mode to run next, so a mode can also
+//	end itself (the drive test does).
+//	Returns once MODE_EXIT is chosen.
+//
+//	Transition policy: going to the menu or exiting stops the
+//	motors. Switching from a running mode to a hot switch mode
+//	(bModeHotSwitch) keeps them running and ramps to the new
+//	mode's commands (driveStartTransition), any other mode
+//	starts from a stop. Odometry, the sonar filters and the
+//	map are never reset on a switch.
+//==========================================================
+void runModeScheduler()
+{
+	short nextMode 		= MODE_DECIDING;
+	short picked 			= MENU_NONE;
+	short event 			= INPUT_NONE;
+	short button 			= 0;
+	long 	nextTick 		= 0;
+	long 	nextStatus 	= 0;
+	long 	nextInput 	= 0;
+	long 	nextTelemetry = 0;
+	long 	wakeTime 		= 0;
+	long 	switchStart = 0;
+	bool 	bFromMenu 	= false;
+	bool 	bRestart 		= false;
+	bool 	bRightLong 	= false;	// the right button press was a long one
+
+	ROBOT_MODE = MODE_DECIDING;
+	applySensorSamplingPlan(MODE_DECIDING);
+	menuShow(MENU_NONE, false);
 
-	// Begin the infinite loop, which analyzes
-	// if objects are too close to the front
-	// or rear (or both front & rear) of robot
 	while( true )
 	{
-		showSonarValuesOnLCD();
+		nextMode 	= ROBOT_MODE;
+		bRestart 	= false;
 
-		// First, handle cases of front and rear proximity
-		// Stuck Mode
-		// Close objects detected in both front and rear
-		if( sonarFrontValGlobal < DEFENSE_FRONT_THRESHOLD &&
-			sonarRearValGlobal < DEFENSE_REAR_THRESHOLD )
+		if( ROBOT_MODE != MODE_DECIDING )
 		{
-			bObjectFront = true;
-	 		bObjectRear = true;
-			//bObjectRight = false;
-			//bObjectLeft = false;
+			// ramp the wheels during a switch, even between ticks
+			driveSlewStep();
 
-			showSonarValuesOnLCD();
+			if( nSysTime >= nextTick )
+			{
+				if( telemetryPage != TELEMETRY_OFF )
+					telemetryTick(modePeriod[ROBOT_MODE]);
+				nextMode = modeTick(ROBOT_MODE);
+
+				// hold a fixed period, without catching up on late ticks
+				nextTick += modePeriod[ROBOT_MODE];
+				if( nextTick <= nSysTime )
+					nextTick = nSysTime + 1;
+			}
 
-	 		if( bObjectRight == false &&
-	 				bObjectLeft == false )
-	 		{
-				stopAllMotors();
+			if( telemetryPage == TELEMETRY_OFF &&
+					modeStatusPeriod[ROBOT_MODE] > 0 && nSysTime >= nextStatus )
+			{
+				modeShowStatus(ROBOT_MODE);
+				nextStatus = nSysTime + modeStatusPeriod[ROBOT_MODE];
 			}
 		}
-		// Object detected too close to front
-		else if( sonarFrontValGlobal < DEFENSE_FRONT_THRESHOLD )
-		{
-			bObjectFront 	= true;
-	 		bObjectRear 	= false; // this may not be correct
-			//bObjectRight = false;
-			//bObjectLeft = false;
-
-			showSonarValuesOnLCD();
 
-			// Backup, indefinitely
-			moveBackwardReact(	SPEED_REAR_DEFAULT );
-		}
-		// Object detected too close to rear
-		else if( sonarRearValGlobal < DEFENSE_REAR_THRESHOLD )
+		// a failed boot check covers the menu, not a running mode
+		if( bootState == BOOT_FAILED && ROBOT_MODE == MODE_DECIDING )
 		{
-			bObjectFront 	= false;
-	 		bObjectRear 	= true;
-			//bObjectRight = false;
-			//bObjectLeft = false;
-
-			showSonarValuesOnLCD();
+			bootShowFailure();
+			bootState = BOOT_REPORTED;
+		}
 
-			// move forward
-			moveForwardReact( SPEED_FRONT_DEFAULT );
+		if( telemetryPage != TELEMETRY_OFF && nSysTime >= nextTelemetry )
+		{
+			telemetryUpdate();
+			showTelemetryOnLCD();
+			nextTelemetry = nSysTime + TELEMETRY_PERIOD;
 		}
-		// Robot is safe distance from objects both
-		// front and rear
-		else
+
+		if( nSysTime >= nextInput )
 		{
-			// no objects were detected front or rear
-			bObjectFront 	= false;
-	 		bObjectRear 	= false;
-
-	 		if( bObjectRight == false &&
-	 				bObjectLeft == false )
-	 		{
-	 			// no objects detected anywhere, so it
-	 			// is ok to stop all motors
-				showSonarValuesOnLCD();
-				stopAllMotors();
+			// one button event per check, the rest wait in the queue
+			event 	= inputNextEvent();
+			button 	= inputEventButton(event);
+			picked 	= MENU_NONE;
+
+			// right moves the menu on release, unless it was held
+			if( inputEventType(event) == INPUT_PRESS && button != 4 )
+			{
+				picked = menuStep(button);
+			}
+			else if( inputEventType(event) == INPUT_RELEASE && button == 4 )
+			{
+				if( !bRightLong )
+					picked = menuStep(button);
+				bRightLong = false;
+			}
+			else if( inputEventType(event) == INPUT_LONG_PRESS && button == 4 )
+			{
+				bRightLong = true;
+				telemetryNextPage();
+				if( telemetryPage != TELEMETRY_OFF )
+				{
+					showTelemetryOnLCD();
+					nextTelemetry = nSysTime + TELEMETRY_PERIOD;
+				}
+				else if( ROBOT_MODE != MODE_DECIDING )
+				{
+					// the title until the next status refresh
+					lcdClearLine(0);
+					lcdCenteredString(0, modeTitle[ROBOT_MODE]);
+					nextStatus = nSysTime;
+				}
+				menuDraw();
 			}
+			if( picked != MENU_NONE )
+			{
+				switch(menuAction[picked])
+				{
+					case MENU_ACTION_MODE:
+						nextMode = menuArg[picked];
+						break;
+					case MENU_ACTION_MISSION:
+						missionSelected = menuArg[picked];
+						nextMode 				= MODE_MISSION;
+						break;
+					case MENU_ACTION_STOP:
+						nextMode = MODE_DECIDING;
+						break;
+					case MENU_ACTION_EXIT:
+						nextMode = MODE_EXIT;
+						break;
+					case MENU_ACTION_DUMP:
+						// off the control loop, the mode keeps running
+						startTask(recordDump, kLowPriority);
+						break;
+				} // end switch
+
+				bRestart = ( nextMode == ROBOT_MODE && ROBOT_MODE != MODE_DECIDING &&
+										 menuAction[picked] != MENU_ACTION_DUMP );
+			}
+			nextInput = nSysTime + MODE_INPUT_PERIOD;
 		}
 
-		// Now handle cases for left & right proximity
-		if( sonarRightValGlobal < DEFENSE_RIGHT_THRESHOLD &&
-						sonarLeftValGlobal < DEFENSE_LEFT_THRESHOLD)
+		if( nextMode != ROBOT_MODE || bRestart )
 		{
-			//bObjectFront = false;
-	 		//bObjectRear = false;
-			bObjectRight 	= true;
-			bObjectLeft 	= true;
+			switchStart = nSysTime;
+			bFromMenu 	= ( ROBOT_MODE == MODE_DECIDING );
 
-			showSonarValuesOnLCD();
+			if( ROBOT_MODE != MODE_DECIDING )
+				modeExit(ROBOT_MODE);
 
-			if( bObjectFront == false &&
-					bObjectRear == false )
+			if( ROBOT_MODE != MODE_DECIDING && nextMode != MODE_DECIDING &&
+					nextMode != MODE_EXIT && bModeHotSwitch[nextMode] )
+			{
+				driveStartTransition();
+			}
+			else
 			{
+				bDriveTransition = false;
 				stopAllMotors();
 			}
-		}
-		// Object detected too close to right side
-		else if( sonarRightValGlobal < DEFENSE_RIGHT_THRESHOLD )
-		{
-			//bObjectFront = false;
-	 		//bObjectRear = false;
-			bObjectRight = true;
-			bObjectLeft = false;
 
-			showSonarValuesOnLCD();
+			// back in the menu, on the entry of the mode that ran
+			if( nextMode == MODE_DECIDING )
+			{
+				picked = menuFind(MENU_ACTION_MODE, ROBOT_MODE);
+				if( ROBOT_MODE == MODE_MISSION )
+					picked = menuFind(MENU_ACTION_MISSION, missionSelected);
+				menuShow(picked, false);
+			}
+
+			ROBOT_MODE = nextMode;
+			if( ROBOT_MODE == MODE_EXIT )
+				return;
 
-			// Backup, indefinitely
-			moveTraverseLeftReact(	SPEED_LEFT_DEFAULT );
-		}
-		// Object detected too close to left side
-		else if( sonarLeftValGlobal < DEFENSE_LEFT_THRESHOLD )
-		{
-			//bObjectFront = false;
-	 		//bObjectRear = false;
-			bObjectRight = false;
-			bObjectLeft = true;
-			showSonarValuesOnLCD();
-
-			// move forward
-			moveTraverseRightReact( SPEED_RIGHT_DEFAULT );
-		}
-		// Robot is safe distance from objects both
-		// right and left
-		else
-		{
-			if( bObjectFront == false &&
-					bObjectRear == false )
+			if( ROBOT_MODE == MODE_DECIDING )
 			{
-				showSonarValuesOnLCD();
-				stopAllMotors();
+				applySensorSamplingPlan(MODE_DECIDING);
 			}
-		}
+			else
+			{
+				// a run picked from the menu starts at home
+				if( bFromMenu && ROBOT_MODE != MODE_RETURNHOME )
+					homeRecord();
 
-		// normal pause time
-		wait1Msec(PAUSETIME);
+				// only read the sensors the chosen mode needs
+				applySensorSamplingPlan(ROBOT_MODE);
+				modeEnter(ROBOT_MODE);
 
-		// Check for User Input from LCD and Joystick
-		if( nLCDButtons == 1 || listenJoystick() == 1) // 1. left button pressed
-		{
-			stopAllMotors();
-			wait1Msec(PAUSETIME); // slow things down a bit
-			return MODE_DEFENSIVE;
+				// STOP MODE is one press away while the mode runs
+				menuShow( menuFind(MENU_ACTION_STOP, 0), true );
+
+				nextTick 		= nSysTime;
+				nextStatus 	= nSysTime;
+				telemetryTickRestart();
+			}
+
+			MAIN_INFO("mode %d in %d ms", ROBOT_MODE, nSysTime - switchStart);
+			lcdCommit();
+			bTaskRan[TASK_MAIN] = true;
+			continue;
 		}
-		else if( nLCDButtons == 2 || listenJoystick() == 2)
+
+		// sleep until the next tick, refresh or button press is due
+		wakeTime = nextInput;
+		if( ROBOT_MODE != MODE_DECIDING )
 		{
-			stopAllMotors();
-			wait1Msec(PAUSETIME); // wait a bit
-			return MODE_EXIT;		// exit out of this function
+			if( nextTick < wakeTime )
+				wakeTime = nextTick;
+			if( modeStatusPeriod[ROBOT_MODE] > 0 && nextStatus < wakeTime )
+				wakeTime = nextStatus;
 		}
-
+		if( telemetryPage != TELEMETRY_OFF && nextTelemetry < wakeTime )
+			wakeTime = nextTelemetry;
+
+		// everything drawn this pass goes to the LCD together
+		lcdCommit();
+		bTaskRan[TASK_MAIN] = true;
+		if( wakeTime > nSysTime )
+			wait1Msec( wakeTime - nSysTime );
 	} // end while
-
-	// if we jumped out of the while loop for some reason,
-	// then exit function
-	stopAllMotors();
-	return MODE_EXIT;
-
-} // end defensiveMode
-
+} // end runModeScheduler
 
 //==========================================================
-//	0
+//	monitorSensors
 //  Constantly runs and gets values from the named
-//  sensors
+//  sensors, following the current sampling plan
 //
 //==========================================================
 task monitorSensors()
 {
-	writeDebugStreamLine("task monitorSensors started");
+	MAIN_INFO("task monitorSensors started");
+
+	long now = 0;
+
+	sonarTrackerReset();
+	odometryReset();
 
 	while( true )
 	{
-		// get the Sonar Values
-		sonarFrontValGlobal = SensorValue[sonarFront];
-		sonarRearValGlobal 	= SensorValue[sonarRear];
-		sonarRightValGlobal = SensorValue[sonarRight];
-		sonarLeftValGlobal 	= SensorValue[sonarLeft];
+		now = nSysTime;
+
+		// get the Sonar Values, and track range and closing speed
+		if( sampleDue(SAMPLE_SONAR_FRONT, now) )
+		{
+			sonarFrontValGlobal = SensorValue[sonarFront];
+			sonarTrackerUpdate(SONAR_FRONT, sonarFrontValGlobal, now);
+		}
+		if( sampleDue(SAMPLE_SONAR_REAR, now) )
+		{
+			sonarRearValGlobal 	= SensorValue[sonarRear];
+			sonarTrackerUpdate(SONAR_REAR, sonarRearValGlobal, now);
+		}
+		if( sampleDue(SAMPLE_SONAR_RIGHT, now) )
+		{
+			sonarRightValGlobal = SensorValue[sonarRight];
+			sonarTrackerUpdate(SONAR_RIGHT, sonarRightValGlobal, now);
+		}
+		if( sampleDue(SAMPLE_SONAR_LEFT, now) )
+		{
+			sonarLeftValGlobal 	= SensorValue[sonarLeft];
+			sonarTrackerUpdate(SONAR_LEFT, sonarLeftValGlobal, now);
+		}
 
 		// get the Line Follower Values
-		lineFollower1ValGlobal = SensorValue[lineFollower1];
-		lineFollower2ValGlobal = SensorValue[lineFollower2];
-		lineFollower3ValGlobal = SensorValue[lineFollower3];
+		if( sampleDue(SAMPLE_LINE, now) )
+		{
+			lineFollower1ValGlobal = SensorValue[lineFollower1];
+			lineFollower2ValGlobal = SensorValue[lineFollower2];
+			lineFollower3ValGlobal = SensorValue[lineFollower3];
+		}
 
-		bFrontBumperPressed = SensorValue[bumpSwitchFront];
+		if( sampleDue(SAMPLE_BUMPER, now) )
+			bFrontBumperPressed = SensorValue[bumpSwitchFront];
 
-		/**
-		if( ROBOT_MODE == MODE_REMOTECONTROL ||  ROBOT_MODE == MODE_DRIVETEST )
-		{
-		// call function from LCDManager.showIECValuesOnLCD()
-		// need to start a task, which samples the IEC values
-		//showIECValuesOnLCD(motorIEC_RF);
-		writeDebugStreamLine("motorIEC_RF %d ",
-		getMotorEncoder(motor_RF) );
-		writeDebugStreamLine("motorIEC_LF %d ",
-		getMotorEncoder(motor_LF) );
-		writeDebugStreamLine("motorIEC_RR %d ",
-		getMotorEncoder(motor_RR) );
-		writeDebugStreamLine("motorIEC_LR %d ",
-		getMotorEncoder(motor_LR) );
-
-		wait1Msec(500);
-		} // end if
-		*/
-
-		wait1Msec(50);
+		// keep the pose up to date for every mode
+		odometryUpdate();
+
+		bTaskRan[TASK_SENSORS] = true;
+		wait1Msec(SAMPLE_BASE_PERIOD);
 
 	} // end while
 }// end monitorSensors
@@ -677,123 +1515,33 @@ task monitorSensors()
 //==========================================================
 task main()
 {
-	writeDebugStreamLine("main");
+	MAIN_INFO("main");
 
 	// instance variabless
 
-	// LCD Initialization Line
-	clearLCDLine(0);
-	clearLCDLine(1);
+	// No splash: the menu is up as soon as the tasks run, the
+	// splash only comes back if a boot check fails
 	bLCDBacklight = true;
-	setLCDPosition(0,0);
-	displayLCDCenteredString(0, "SENTINAL");
-	setLCDPosition(1,0);
-
-	wait1Msec(100);
-	for( int i = 0; i < 15; i++)
-	{
-		displayNextLCDChar('.');
-		wait1Msec(50);
-	} // end for loop
 
 	// Start Task of monitoring the Motor IECs
+	applySensorSamplingPlan(MODE_DECIDING);
 	startTask(monitorSensors);
 
-	checkSystemComponents();
-
+	// From here on the LCD is drawn from lcdFrame only,
+	// above telemetryIdle so its time is not taken for idle
+	startTask(lcdRenderer, kLowPriority + 1);
+	startTask(inputMonitor);
+	startTask(logDrain, kLowPriority);
 
+	// battery, encoders and sonars, while the menu runs
+	startTask(checkSystemComponents, kLowPriority);
 
-	// Start the LCD Menu choices and let user decide what to do
-	//short mode = displayLCDChoice_Initial();
-	ROBOT_MODE = displayLCDChoice_Initial();
-	bool firstTime = true;
-
-	while(true)
-	{
-
-		if(firstTime)
-		{
-			firstTime = false;
-		}
-
-		// If not first time through loop, then we can call the
-		// displayLCDChoice_XXX functions
-		// This puts the LCD back into a user decision making mode
-		if(!firstTime)
-		{
-			switch(ROBOT_MODE)
-			{
-			case MODE_REMOTECONTROL:
-				ROBOT_MODE = displayLCDChoice_Initial();
-				break;
-			case MODE_DRIVETEST:
-				ROBOT_MODE = displayLCDChoice_DriveTest();
-				break;
-			case MODE_TRACKLINE:
-				ROBOT_MODE = displayLCDChoice_TrackLine();
-				break;
-			case MODE_BEHAVIORAL:
-				ROBOT_MODE = displayLCDChoice_Behavioral();
-				break;
-			case MODE_DISCOVERY:
-				ROBOT_MODE = displayLCDChoice_Discovery();
-				break;
-			case MODE_MAPPING:
-				ROBOT_MODE = displayLCDChoice_Mapping();
-				break;
-			case MODE_DEFENSIVE:
-				ROBOT_MODE = displayLCDChoice_Defensive();
-				break;
-			case MODE_DECIDING:
-				ROBOT_MODE = displayLCDChoice_Initial();
-				break;
-			default:
-				ROBOT_MODE = MODE_EXIT;
-				break;
-			} // end switch
-		} // end if firstTime check
-
-		switch(ROBOT_MODE)
-		{
-			case MODE_REMOTECONTROL:
-				ROBOT_MODE = remoteControlMode();
-				break;
-			case MODE_DRIVETEST:
-				ROBOT_MODE = runDrivingTestBasic(	40, //SPEED_FRONT_DEFAULT,
-																					0, // run time
-																					2000, // pauses
-																					true, true, true, true,
-																					//true, false, false, false,
-																					12.0 ); // distance inches
-																					break;
-			case MODE_TRACKLINE:
-				ROBOT_MODE = trackLineMode();
-				break;
-			case MODE_BEHAVIORAL:
-				ROBOT_MODE = behavioralMode();
-				break;
-			case MODE_DISCOVERY:
-				ROBOT_MODE = discoveryMode();
-				break;
-			case MODE_MAPPING:
-				ROBOT_MODE = mappingMode();
-				break;
-			case MODE_DEFENSIVE:
-				ROBOT_MODE = defensiveMode();
-				break;
-			case MODE_DECIDING:
-				ROBOT_MODE = displayLCDChoice_Initial();
-				break;
-			default:
-				ROBOT_MODE = MODE_EXIT;
-				break;
-		} // end switch
-
-		if(ROBOT_MODE == MODE_EXIT)
-		{
-			break; // break out of the infinite while loop
-		}
-	} // end while loop
+	// Let the user pick a mode from the LCD menu and run it,
+	// until EXIT is chosen
+	modeRegistryInit();
+	menuTreeInit();
+	MAIN_INFO("boot: menu ready %d ms after start", nPgmTime);
+	runModeScheduler();
 
 	// Cleanup and Shutdown Procedure
 	stopAllMotors();
@@ -801,6 +1549,7 @@ task main()
 
 	// LCD Goodbye Message
 	populateLCDMenu("     GOODBYE    ", EMPTY);
+	lcdCommit();
 	wait1Msec(2000);
 	bLCDBacklight = false;
 
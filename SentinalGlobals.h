@@ -7,6 +7,11 @@ static const short MODE_BEHAVIORAL 		= 4;
 static const short MODE_DISCOVERY 		= 5;
 static const short MODE_MAPPING 			= 6;
 static const short MODE_DEFENSIVE			= 7;
+static const short MODE_EXPLORE				= 8;
+static const short MODE_WALLFOLLOW		= 9;
+static const short MODE_RETURNHOME		= 10;
+static const short MODE_REPLAY				= 11;
+static const short MODE_MISSION				= 12;
 static const short MODE_DECIDING			= 100;
 static short ROBOT_MODE 							= MODE_DECIDING;
 
@@ -26,6 +31,20 @@ static const short DEFENSE_FRONT_THRESHOLD 	= 18;
 static const short DEFENSE_REAR_THRESHOLD 	= 12;
 static const short DEFENSE_RIGHT_THRESHOLD 	= 12;
 static const short DEFENSE_LEFT_THRESHOLD 	= 12;
+static const short DEFENSE_HYSTERESIS 			= 4;		// inches
+static const float DEFENSE_SPEED_MIN_SCALE 	= 0.5;	// at the release distance, ~0.6 at the threshold
+static const float DEFENSE_DEADBAND 				= 4.0;	// speed, smaller pushes are dropped
+static const int 	 DEFENSE_CONTROL_PERIOD 	= 25;		// ms
+
+//==========================================================
+// ASSISTED REMOTE CONTROL
+// Joystick speed toward an object is limited so the robot
+// can always stop short of it:
+//   stopping distance = ASSIST_MARGIN + ASSIST_STOP_GAIN * speed
+// Speed away from it is never limited.
+//==========================================================
+static const float ASSIST_MARGIN 			= 5.0;	// inches
+static const float ASSIST_STOP_GAIN 	= 0.2;	// inches per unit of motor speed
 
 //==========================================================
 // THE GLOBAL VARIABLES FOR MOVING DIRECTION
@@ -51,6 +70,97 @@ static short DIRECTION 										= 90; // front is default
 static const float MOVEMENT_LINEAR_ADJUSTER 	= 21.0;
 static const float MOVEMENT_LATERAL_ADJUSTER 	= 0.45;
 static const float MOVEMENT_OBLIQUE_ADJUSTER 	= 0.45;
+// inches of wheel travel per radian the robot rotates,
+// half the wheelbase plus half the track width
+static const float MOVEMENT_ROTATE_ADJUSTER 	= 12.0;
+// rotate speed per degree off the held heading
+static const float MOVEMENT_HEADING_KP 				= 1.2;
+// inches between the centers of two neighboring line
+// sensors across the front of the chassis
+static const float LINE_SENSOR_SPACING 				= 0.5;
+
+// moveDistanceStep results
+static const short MOVE_STEP_RUNNING 					= 0;
+static const short MOVE_STEP_DONE 						= 1;
+static const short MOVE_STEP_ABORT 						= 2;	// collision or IEC error
+// passes timed by driveLogBenchmark
+static const int 	 DRIVE_BENCHMARK_PASSES 			= 1000;
+
+//==========================================================
+//  MODE TRANSITIONS
+//  For MODE_TRANSITION_TIME after a switch between two modes
+//  the wheels are ramped from the old command to the new one
+//  at no more than DRIVE_SLEW_RATE, instead of stopping.
+//==========================================================
+static const int 		MODE_TRANSITION_TIME 	= 400;	// ms
+static const float 	DRIVE_SLEW_RATE 			= 0.6;	// motor power per ms
+
+static int 		driveTarget[4];								// LF, LR, RF, RR
+static bool 	bDriveTransition 			= false;
+static long 	driveTransitionEnd 		= 0;
+static long 	driveSlewTimeLast 		= 0;
+
+//==========================================================
+//  LCD
+//  Everything is written to a frame in RAM, the lcdRenderer
+//  task sends only the characters that changed to the LCD.
+//==========================================================
+static const short 	LCD_COLUMNS 					= 16;
+static const short 	LCD_CELLS 						= 32;		// 2 lines of LCD_COLUMNS
+static const int 		LCD_RENDER_PERIOD 		= 50;		// ms between updates
+static const short 	LCD_RENDER_MAX_CHARS 	= 16;		// characters sent per update
+
+//==========================================================
+//  INPUT EVENTS
+//  The inputMonitor task reads the LCD buttons and the
+//  joystick buttons standing in for them, and queues an
+//  event for each debounced change:
+//		event = INPUT_XXX * 8 + button (1 left, 2 center, 4 right)
+//==========================================================
+static const int 		INPUT_SAMPLE_PERIOD 	= 10;		// ms
+static const int 		INPUT_DEBOUNCE_TIME 	= 20;		// ms a change must hold
+static const int 		INPUT_LONG_PRESS_TIME = 700;	// ms held for a long press
+static const short 	INPUT_QUEUE_SIZE 			= 8;
+
+static const short 	INPUT_NONE 						= 0;
+static const short 	INPUT_PRESS 					= 1;
+static const short 	INPUT_RELEASE 				= 2;
+static const short 	INPUT_LONG_PRESS 			= 3;
+
+//==========================================================
+//  EVENT LOG
+//  Ring of binary records for the drive hot paths, written
+//  out as text by the logDrain task (EventLog.h)
+//==========================================================
+static const short 	LOG_SIZE 							= 64;		// records
+static const int 		LOG_DRAIN_PERIOD 			= 50;		// ms
+static const short 	LOG_DRAIN_MAX 				= 8;		// records written per period
+
+//==========================================================
+//  BOOT CHECKS
+//  checkSystemComponents runs as a task next to the menu, so
+//  the robot is ready while the checks still wait for the
+//  encoders and sonars. Only a failed check shows on the LCD.
+//==========================================================
+static const int 		BOOT_BATTERY_MIN 			= 6800;	// mV
+static const short 	BOOT_IEC_COUNT 				= 4;		// encoders on the I2C chain
+static const short 	BOOT_SONAR_SAMPLES 		= 5;		// readings before a sonar can fail
+static const int 		BOOT_CHECK_TIMEOUT 		= 1000;	// ms to wait for encoders and samples
+static const int 		BOOT_CHECK_PERIOD 		= 20;		// ms between looks
+
+static const short 	BOOT_CHECKING 				= 0;
+static const short 	BOOT_PASSED 					= 1;
+static const short 	BOOT_FAILED 					= 2;
+static const short 	BOOT_REPORTED 				= 3;		// failure shown on the LCD
+
+// bootFailure bits
+static const short 	BOOT_LOW_BATTERY 			= 1;
+static const short 	BOOT_NO_ENCODERS 			= 2;
+static const short 	BOOT_NO_SONAR 				= 4;
+
+static short 	bootState 									= BOOT_CHECKING;
+static short 	bootFailure 								= 0;
+static short 	bootSonarSilent 						= 0;		// 1 << SONAR_XXX, no echo at all
 
 //==========================================================
 //  PAUSE TIMES
@@ -74,3 +184,383 @@ static int lineFollower1ValGlobal;
 static int lineFollower2ValGlobal;
 static int lineFollower3ValGlobal;
 static int bFrontBumperPressed;
+
+//==========================================================
+//  LINE FOLLOWING
+//  Line position is measured in thousandths of the spacing
+//  between two line sensors (LINE_SENSOR_SPACING):
+//  -1000 (under lineFollower1) .. 0 .. 1000 (under lineFollower3)
+//==========================================================
+static const int 		LINE_CONTROL_PERIOD 		= 10;		// ms
+static const int 		LINE_DARK_THRESHOLD 		= 1500;	// above is line
+static const int 		LINE_MIN_SIGNAL 				= 300; 	// sum of darkness
+static const int 		LINE_POSITION_SCALE 		= 1000;	// position under an outer sensor
+static const short 	LINE_SPEED_FORWARD 			= 35;
+static const short 	LINE_SPEED_SEARCH 			= 30;
+static const int 		LINE_LOST_TIMEOUT 			= 1500;	// ms
+static const int 		LINE_SWEEP_TIME 				= 200;	// ms, first sweep of a blind search
+static const int 		LINE_LAP_DEBOUNCE 			= 2000;	// ms
+static const float 	LINE_KP 								= 0.045;
+static const float 	LINE_KI 								= 0.0004;
+static const float 	LINE_KD 								= 0.3;
+static const float 	LINE_KYAW 							= 0.08;
+static const float 	LINE_INTEGRAL_LIMIT 		= 20000.0;
+
+//==========================================================
+//  WALL FOLLOWING
+//  Hold WALL_DISTANCE inches from the wall on one side,
+//  measured by the filtered side sonar, by strafing, while
+//  driving forward and holding the heading.
+//==========================================================
+static const int 		WALL_CONTROL_PERIOD 		= 25;		// ms
+static const float 	WALL_DISTANCE 					= 10.0;	// inches
+static const float 	WALL_LOST_RANGE 				= 30.0;	// inches, no wall beyond
+static const int 		WALL_LOST_TIMEOUT 			= 1000;	// ms
+static const short 	WALL_SPEED_FORWARD 			= 50;
+static const short 	WALL_SPEED_LOST 				= 25;
+static const short 	WALL_STRAFE_MAX 				= 50;
+static const float 	WALL_KP 								= 4.0;	// speed per inch
+static const float 	WALL_KI 								= 0.02;	// speed per inch tick
+static const float 	WALL_KD 								= 0.6;	// speed per inch per second
+static const float 	WALL_INTEGRAL_LIMIT 		= 500.0;
+static const int 		WALL_FRONT_THRESHOLD 		= 14;		// inches, corner ahead
+static const short 	WALL_TURN_SPEED_MIN 		= 18;
+static const short 	WALL_TURN_SPEED_MAX 		= 40;
+static const float 	WALL_TURN_TOLERANCE 		= 4.0;	// degrees
+
+//==========================================================
+//  SENSOR SAMPLING PLAN
+//  monitorSensors reads each sensor group at its own period.
+//  The periods are set per mode by applySensorSamplingPlan.
+//  A period of 0 turns that sensor group off; its global
+//  keeps the last value read.
+//  A sonar only measures once per SONAR_ECHO_PERIOD, in
+//  between SensorValue returns the same cached reading, so
+//  that is the ceiling on new sonar data. A shorter sonar
+//  period only picks each new reading up sooner.
+//==========================================================
+static const short 	SAMPLE_SONAR_FRONT 	= 0;
+static const short 	SAMPLE_SONAR_REAR 	= 1;
+static const short 	SAMPLE_SONAR_RIGHT 	= 2;
+static const short 	SAMPLE_SONAR_LEFT 	= 3;
+static const short 	SAMPLE_LINE 				= 4;
+static const short 	SAMPLE_BUMPER 			= 5;
+static const short 	SAMPLE_COUNT 				= 6;
+
+static const int 		SAMPLE_BASE_PERIOD 	= 5;	// ms, monitorSensors tick
+static const int 		SAMPLE_OFF 					= 0;
+
+static int 	samplePeriod[SAMPLE_COUNT];		// ms
+static long sampleTimeLast[SAMPLE_COUNT];	// nSysTime of last read
+
+//==========================================================
+//  SONAR TRACKING
+//  Index of each sonar in the sonar tracker arrays
+//==========================================================
+static const short 	SONAR_FRONT 					= 0;
+static const short 	SONAR_REAR 						= 1;
+static const short 	SONAR_RIGHT 					= 2;
+static const short 	SONAR_LEFT 						= 3;
+static const short 	SONAR_COUNT 					= 4;
+
+static const float 	SONAR_MAX_RANGE 			= 120.0;	// inches
+static const float 	SONAR_ALPHA 					= 0.5;
+static const float 	SONAR_BETA 						= 0.2;
+static const float 	SONAR_GATE 						= 24.0;		// inches, jump = new target
+static const float 	SONAR_MIN_CLOSING 		= 4.0;		// inches per second
+static const long 	SONAR_TTC_NONE 				= 99999;	// ms, nothing closing in
+static const int 		SONAR_ECHO_PERIOD 		= 50;			// ms, a sonar pings again within this
+
+//==========================================================
+//  TIME TO CONTACT LIMITS IN MILLISECONDS
+//  React to anything that will reach the robot sooner
+//  than this, even if it is still beyond the
+//  DEFENSE_XXX_THRESHOLD distance
+//==========================================================
+static const long 	DEFENSE_TTC_THRESHOLD = 1000;
+
+// defensiveMode: which sonars the robot is escaping from
+static bool 	bDefenseEscaping[SONAR_COUNT];
+
+//==========================================================
+//  BEHAVIORAL MODE STATES
+//  behavioralMode advances one state step per control tick
+//==========================================================
+static const short 	BEHAVIOR_IDLE 						= 0; // watching the rear
+static const short 	BEHAVIOR_THREAT_BEHIND 		= 1; // confirm the threat
+static const short 	BEHAVIOR_TURNING 					= 2; // turning 180 degrees
+static const short 	BEHAVIOR_FACING 					= 3; // facing the threat
+
+static const int 		BEHAVIOR_CONTROL_PERIOD 	= 20;		// ms
+static const float 	BEHAVIOR_TURN_ANGLE 			= 180.0;	// degrees
+static const float 	BEHAVIOR_TURN_TOLERANCE 	= 4.0;		// degrees
+static const float 	BEHAVIOR_TURN_KP 					= 0.6;		// speed per degree
+static const short 	BEHAVIOR_TURN_SPEED_MIN 	= 18;
+
+static short 	behaviorState 				= BEHAVIOR_IDLE;
+static long 	behaviorThreatTime 		= 0;		// nSysTime threat was seen
+static long 	behaviorTurnStart 		= 0;		// nSysTime turn started
+static float 	behaviorTurnHeading 	= 0.0;	// odomHeading last tick
+static float 	behaviorTurned 				= 0.0;	// degrees clockwise so far
+
+//==========================================================
+//  DISCOVERY SWEEP SCAN
+//  The robot turns in place and bins every sonar echo by
+//  its direction in the world frame (0 = DIRECTION_RIGHT)
+//==========================================================
+static const short 	SCAN_BIN_DEGREES 			= 5;
+static const short 	SCAN_BIN_COUNT 				= 72;	// 360 / SCAN_BIN_DEGREES
+static const short 	SCAN_BIN_SAMPLES 			= 5;	// kept per bin for the median
+static const int 		SCAN_CONTROL_PERIOD 	= 30;	// ms
+static const float 	SCAN_RATE 						= 45.0;	// degrees per second
+static const float 	SCAN_KP 							= 1.5;	// speed per degree behind
+static const short 	SCAN_SPEED_FEED 			= 22;		// speed to turn at SCAN_RATE
+static const short 	SCAN_SPEED_MAX 				= 40;
+
+static bool 	bDiscoverySweepDone 	= false;
+
+//==========================================================
+//  MAPPING
+//  Log-odds occupancy grid, one signed byte per cell.
+//  The grid is a MAP_SIZE x MAP_SIZE window that scrolls
+//  with the robot in steps of MAP_SCROLL_STEP cells.
+//==========================================================
+static const short 	MAP_SIZE 							= 40;		// cells per side
+static const float 	MAP_CELL_SIZE 				= 4.0;	// inches
+static const short 	MAP_SCROLL_MARGIN 		= 8;		// cells from the edge
+static const short 	MAP_SCROLL_STEP 			= 10;		// cells per scroll
+static const int 		MAP_UPDATE_PERIOD 		= 30;		// ms
+
+static const short 	MAP_LOG_HIT 					= 16;		// echo in the cell
+static const short 	MAP_LOG_MISS 					= -6;		// beam passed through
+static const short 	MAP_LOG_MAX 					= 100;
+static const short 	MAP_LOG_MIN 					= -100;
+static const short 	MAP_LOG_OCCUPIED 			= 30;		// above is occupied
+static const short 	MAP_LOG_FREE 					= -30;	// below is free
+
+static const float 	MAP_CONE_HALF_ANGLE 	= 12.0;	// degrees, sonar beam
+static const short 	MAP_CONE_RAYS 				= 3;
+static const float 	MAP_FREE_RANGE_MAX 		= 48.0;	// inches cleared on no echo
+static const short 	MAP_RAY_STEPS_MAX 		= 24;		// cells along one ray
+
+//==========================================================
+//  MAP STORE
+//  Sparse long term map behind the scrolling grid window.
+//  8 x 8 cell tiles at 2 bits per cell, found by hashing
+//  the tile coordinates. Unknown tiles take no memory.
+//==========================================================
+static const short 	MAP_TILE_SIZE 				= 8;		// cells per side
+static const short 	MAP_TILE_POOL 				= 128;	// tiles in memory
+static const short 	MAP_HASH_SIZE 				= 256;	// power of 2
+static const short 	MAP_HASH_EMPTY 				= -1;
+
+// 2 bit cell states
+static const short 	MAP_STATE_UNKNOWN 		= 0;
+static const short 	MAP_STATE_FREE 				= 1;
+static const short 	MAP_STATE_OCCUPIED 		= 2;
+static const short 	MAP_STATE_UNSURE 			= 3; // seen, not decided
+static const short 	MAP_CHANGE_QUEUE 			= 64;		// cells, see mapChanged
+
+//==========================================================
+//  PATH PLANNING
+//  D* Lite over a coarse PLAN_SIZE x PLAN_SIZE grid of
+//  plan cells, each PLAN_CELL_CELLS x PLAN_CELL_CELLS map cells
+//==========================================================
+static const short 	PLAN_SIZE 						= 16;
+static const short 	PLAN_CELLS 						= 256;	// PLAN_SIZE * PLAN_SIZE
+static const short 	PLAN_CELL_CELLS 			= 2;		// 8 inch plan cells
+static const short 	PLAN_INFLATE 					= 1;		// map cells of clearance
+static const short 	PLAN_INFINITY 				= 32000;
+static const short 	PLAN_COST_UNIT 				= 10;		// one plan cell straight ahead
+static const short 	PLAN_PATH_MAX 				= 48;		// waypoints
+static const short 	PLAN_GOAL_SNAP 				= 1;		// plan cells a blocked goal may move
+
+//==========================================================
+//  EXPLORATION
+//  Frontier cells are free cells next to unknown ones.
+//  Frontiers are scored on unknown cells around them
+//  (information gain) against the distance to drive.
+//==========================================================
+static const int 		EXPLORE_CONTROL_PERIOD 	= 30;		// ms
+static const int 		EXPLORE_REPLAN_PERIOD 	= 300;	// ms
+static const short 	EXPLORE_GAIN_RADIUS 		= 2;		// map cells
+static const float 	EXPLORE_GAIN_WEIGHT 		= 6.0;	// inches per unknown cell
+static const float 	EXPLORE_RANGE 					= 56.0;	// inches per goal, fits the plan grid
+static const float 	EXPLORE_MIN_DISTANCE 		= 12.0;	// inches
+static const short 	EXPLORE_SPEED 					= 35;
+static const short 	EXPLORE_FAILED_MAX 			= 8;		// unreachable goals remembered
+static const short 	EXPLORE_SCAN_ROWS 			= 4;		// map rows searched per tick
+static const float 	EXPLORE_AREA_TARGET 		= 2.0;	// m2 mapped per minute
+
+static const short 	EXPLORE_SELECT 					= 0;
+static const short 	EXPLORE_DRIVE 					= 1;
+static const short 	EXPLORE_SWEEP 					= 2;
+static const short 	EXPLORE_DONE 						= 3;
+
+// exploreSelectStep results
+static const short 	EXPLORE_SELECT_RUNNING 	= 0;
+static const short 	EXPLORE_SELECT_FOUND 		= 1;
+static const short 	EXPLORE_SELECT_NONE 		= 2;
+
+//==========================================================
+//  PATH FOLLOWING
+//  Pure pursuit over a polyline of waypoints: drive toward
+//  the point PURSUIT_LOOKAHEAD inches further along the path
+//  than the robot, while steering the heading on its own.
+//==========================================================
+static const int 		PURSUIT_CONTROL_PERIOD 	= 20;		// ms
+static const short 	PURSUIT_PATH_MAX 				= 48;		// waypoints, same as PLAN_PATH_MAX
+static const float 	PURSUIT_LOOKAHEAD 			= 8.0;	// inches
+static const float 	PURSUIT_GOAL_TOLERANCE 	= 2.0;	// inches
+static const float 	PURSUIT_SPEED_KP 				= 3.0;	// speed per inch left to go
+static const short 	PURSUIT_SPEED_MIN 			= 15;		// enough to keep moving
+static const long 	PURSUIT_TIMEOUT 				= 30000;	// ms, test runs only
+
+//==========================================================
+//  RETURN HOME
+//  Plan back to the pose recorded when the last mode was
+//  picked from the menu, in legs of at most HOME_LEG_RANGE
+//  so each leg fits the plan grid, then close in slowly and
+//  turn to the recorded heading.
+//==========================================================
+static const int 		HOME_CONTROL_PERIOD 		= 30;		// ms
+static const int 		HOME_REPLAN_PERIOD 			= 300;	// ms
+static const int 		HOME_RETRY_PERIOD 			= 1000;	// ms, blocked
+static const float 	HOME_LEG_RANGE 					= 48.0;	// inches
+static const short 	HOME_RETRY_MAX 					= 4;		// failed legs before giving up
+static const float 	HOME_PROGRESS_MIN 			= 2.0;	// inches closer per leg
+static const short 	HOME_SPEED 							= 40;
+static const float 	HOME_APPROACH_DISTANCE 	= 12.0;	// inches, final approach
+static const float 	HOME_APPROACH_KP 				= 4.0;	// speed per inch
+static const short 	HOME_APPROACH_SPEED_MIN = 12;
+static const short 	HOME_APPROACH_SPEED_MAX = 20;
+static const float 	HOME_TOLERANCE 					= 0.75;	// inches
+static const float 	HOME_HEADING_TOLERANCE 	= 2.0;	// degrees
+static const short 	HOME_TURN_SPEED_MIN 		= 14;
+static const short 	HOME_TURN_SPEED_MAX 		= 30;
+static const int 		HOME_FRONT_THRESHOLD 		= 10;		// inches, stop and replan
+
+static const short 	HOME_PLAN 							= 0;
+static const short 	HOME_DRIVE 							= 1;
+static const short 	HOME_APPROACH 					= 2;
+static const short 	HOME_ALIGN 							= 3;
+static const short 	HOME_DONE 							= 4;
+static const short 	HOME_BLOCKED 						= 5;
+
+static float 	homeX 									= 0.0;	// where the run started
+static float 	homeY 									= 0.0;
+static float 	homeHeading 						= 90.0;
+
+//==========================================================
+//  RECORD AND REPLAY
+//  remoteControlMode records the driven speeds, replayMode
+//  drives them again. See TeleopRecorder.h for the format.
+//==========================================================
+static const int 		RECORD_BUFFER_SIZE 			= 6144;	// bytes
+static const int 		RECORD_TIME_UNIT 				= 20;		// ms, one remote control tick
+static const short 	RECORD_SPEED_STEP 			= 4;		// motor speed per recorded step
+static const int 		RECORD_POSE_PERIOD 			= 500;	// ms between pose snapshots
+static const float 	RECORD_POSE_STEP 				= 0.25;	// inches per recorded step
+static const int 		RECORD_DUMP_PERIOD 			= 20;		// ms between dumped lines
+static const float 	REPLAY_KP 							= 3.0;	// speed per inch off the recording
+static const float 	REPLAY_HEADING_KP 			= 1.5;	// speed per degree off
+static const short 	REPLAY_CORRECTION_MAX 	= 30;
+
+//==========================================================
+//  MISSIONS
+//  Autonomous routines written as bytecode (Missions.h) and
+//  run one step per tick by MissionRunner.h
+//==========================================================
+static const int 		MISSION_CONTROL_PERIOD 	= 20;		// ms
+static const short 	MISSION_LOOP_DEPTH 			= 4;		// nested LOOPs
+static const float 	MISSION_MOVE_TOLERANCE 	= 0.5;	// inches
+static const float 	MISSION_SPEED_KP 				= 4.0;	// speed per inch left to go
+static const short 	MISSION_SPEED_MIN 			= 15;
+static const float 	MISSION_TURN_TOLERANCE 	= 3.0;	// degrees
+static const short 	MISSION_TURN_SPEED_MIN 	= 15;
+static const long 	MISSION_STEP_TIMEOUT 		= 10000;	// ms for one MOVE or ROTATE
+static const int 		MISSION_BENCHMARK_STEPS = 200;		// timed by missionBenchmark
+
+static const short 	MISSION_RUNNING 				= 0;
+static const short 	MISSION_DONE 						= 1;
+static const short 	MISSION_FAILED 					= 2;
+
+//==========================================================
+//  MODE REGISTRY
+//  One entry per mode, indexed by its MODE_XXX value and
+//  filled in by modeRegistryInit. runModeScheduler enters,
+//  ticks and exits the active mode from this table; the
+//  menu tree (MENU TREE below) points at them.
+//==========================================================
+static const short 	MODE_COUNT 					= 13;		// MODE_EXIT .. MODE_MISSION
+static const int 		MODE_INPUT_PERIOD 	= 20;		// ms between button checks
+
+static string 	modeMenuLabel[MODE_COUNT];			// menu question
+static string 	modeTitle[MODE_COUNT];					// first LCD line while running
+static int 			modePeriod[MODE_COUNT];					// ms between ticks
+static int 			modeStatusPeriod[MODE_COUNT];		// ms between LCD refreshes, 0 for none
+static bool 		bModeHotSwitch[MODE_COUNT];			// can be switched to while moving
+
+//==========================================================
+//  MENU TREE
+//  One entry per menu node, filled in by menuTreeInit.
+//  Node 0 is the root, its children are the top level.
+//  Siblings are linked both ways so the menu can be walked
+//  without recursion, see menuStep in LCDManager.h.
+//==========================================================
+static const short 	MENU_NODE_MAX 				= 32;
+static const short 	MENU_NONE 						= -1;
+static const short 	MENU_ROOT 						= 0;
+
+static const short 	MENU_ACTION_SUBMENU 	= 0;		// open the children
+static const short 	MENU_ACTION_MODE 			= 1;		// run mode menuArg
+static const short 	MENU_ACTION_MISSION 	= 2;		// run mission menuArg
+static const short 	MENU_ACTION_STOP 			= 3;		// stop the running mode
+static const short 	MENU_ACTION_EXIT 			= 4;		// end the program
+static const short 	MENU_ACTION_DUMP 			= 5;		// dump the last recording
+
+static string 	menuLabel[MENU_NODE_MAX];
+static short 		menuAction[MENU_NODE_MAX];
+static short 		menuArg[MENU_NODE_MAX];
+static short 		menuParent[MENU_NODE_MAX];
+static short 		menuChild[MENU_NODE_MAX];				// first child
+static short 		menuNext[MENU_NODE_MAX];				// next sibling
+static short 		menuPrev[MENU_NODE_MAX];				// previous sibling
+static short 		menuNodeCount 			= 0;
+static short 		menuCursor 					= MENU_NONE;
+static bool 		bMenuOverMode 			= false;	// a mode runs under the menu
+
+//==========================================================
+//  TELEMETRY
+//  Pages for tuning on the floor, shown on the first LCD
+//  line instead of the mode status. A long press of the
+//  right button goes to the next page, after the last one
+//  the pages are off. Telemetry.h works the numbers out
+//  every TELEMETRY_PERIOD, over that period.
+//==========================================================
+static const int 		TELEMETRY_PERIOD 			= 250;	// ms
+static const short 	TELEMETRY_OFF 				= 0;
+static const short 	TELEMETRY_WHEELS 			= 1;		// wheel speeds, in/s
+static const short 	TELEMETRY_LOOP 				= 2;		// control loop period and jitter
+static const short 	TELEMETRY_CPU 				= 3;		// busy percent per task
+static const short 	TELEMETRY_BATTERY 		= 4;		// battery mV
+static const short 	TELEMETRY_SONAR 			= 5;		// new sonar readings per second
+static const short 	TELEMETRY_PAGES 			= 5;
+static const float 	TELEMETRY_COST_GAIN 	= 0.05;	// per run, see telemetryIdle
+
+// tasks timed in taskBusyTime, see telemetryIdle
+static const short 	TASK_MAIN 						= 0;		// mode scheduler
+static const short 	TASK_SENSORS 					= 1;		// monitorSensors
+static const short 	TASK_LCD 							= 2;		// lcdRenderer
+static const short 	TASK_INPUT 						= 3;		// inputMonitor
+static const short 	TASK_COUNT 						= 4;
+
+static short 	telemetryPage 							= TELEMETRY_OFF;
+static bool 	bTaskRan[TASK_COUNT];							// set by each task before it sleeps
+static float 	taskBusyTime[TASK_COUNT];					// ms, added by telemetryIdle
+static float 	telemetryWheelSpeed[4];						// in/s RF, LF, RR, LR
+static float 	telemetryLoopPeriod 				= 0.0;	// ms, average tick to tick
+static float 	telemetryLoopJitter 				= 0.0;	// ms, average off the period
+static float 	telemetryLoopJitterMax 			= 0.0;	// ms
+static short 	telemetryTaskLoad[TASK_COUNT];		// percent
+static float 	telemetrySonarRate[SONAR_COUNT];	// samples per second
@@ -0,0 +1,282 @@
+/*
+		SonarScan.h
+		Polar range scan around the robot, built from sonar echoes
+		while it turns in place (see discoveryMode).
+
+		360 degrees are split into SCAN_BIN_COUNT bins of
+		SCAN_BIN_DEGREES each. For each bin the scan keeps
+		-	the number of echoes that fell into it
+		-	the shortest range seen
+		-	the last SCAN_BIN_SAMPLES ranges, for the median
+		Angles are in the world frame of Odometry.h, counter clockwise
+		from the x axis, so the scan stays valid after the robot turns.
+
+		Memory: SCAN_BIN_COUNT * (SCAN_BIN_SAMPLES + 2) shorts, ~1 KB
+
+		Sweep: scanSweepStart / scanSweepStep turn the robot one full
+		turn counter clockwise under closed loop heading control, adding
+		every new reading of all four sonars to the scan (a change of
+		sonarSampleCount, see SonarTracker.h). With four sonars each bin
+		is seen four times per turn.
+		Like the moveXXX functions, the sweep gives up when a wheel IEC
+		has not changed for IEC_ERROR_TIMEOUT while the wheels are
+		driven: the motors stop and bScanFailed is set, so the robot
+		does not turn for ever on a dead encoder.
+*/
+
+static short scanBinMin[SCAN_BIN_COUNT];
+static short scanBinCount[SCAN_BIN_COUNT];
+static short scanBinSamples[SCAN_BIN_COUNT * SCAN_BIN_SAMPLES];
+
+// mounting direction of each sonar, degrees counter clockwise
+// from the front of the robot, indexed by SONAR_XXX
+static const float SCAN_SONAR_OFFSET[SONAR_COUNT] = { 0.0, 180.0, -90.0, 90.0 };
+
+// sweep state
+static float 	scanTurned 						= 0.0;	// degrees counter clockwise so far
+static float 	scanHeadingLast 			= 0.0;
+static long 	scanSweepStartTime 		= 0;
+static long 	scanSampleCountLast[SONAR_COUNT];
+static float 	scanWheelLast[4];							// odomWheelTravel, RF, LF, RR, LR
+static long 	scanWheelTime[4];							// nSysTime the wheel last turned
+static bool 	bScanFailed 					= false;
+
+// FUNCTION DECLARATIONS
+void 	scanReset();
+void 	scanSweepStart();
+bool 	scanSweepStep();
+bool 	scanWheelStalled(bool bDriven);
+short scanBinIndex(float angle);
+void 	scanAddSample(float angle, int range);
+short scanRangeMin(short bin);
+short scanRangeMedian(short bin);
+short scanCount(short bin);
+short scanRangeAt(float angle);
+
+//==========================================================
+//	scanReset
+//	Empty every bin
+//==========================================================
+void scanReset()
+{
+	for( int i = 0; i < SCAN_BIN_COUNT; i++ )
+	{
+		scanBinMin[i] 	= 0;
+		scanBinCount[i] = 0;
+	}
+} // end scanReset
+
+//==========================================================
+//	scanBinIndex
+//	Bin that a world angle in degrees falls into
+//==========================================================
+short scanBinIndex(float angle)
+{
+	while( angle >= 360.0 )
+		angle -= 360.0;
+	while( angle < 0.0 )
+		angle += 360.0;
+
+	short bin = (short)( angle / SCAN_BIN_DEGREES );
+	if( bin >= SCAN_BIN_COUNT )
+		bin = 0;
+
+	return bin;
+} // end scanBinIndex
+
+//==========================================================
+//	scanAddSample
+//	Add one echo, range in inches, seen in the world
+//	direction angle (degrees)
+//==========================================================
+void scanAddSample(float angle, int range)
+{
+	// no echo carries no range information
+	if( range < 0 )
+		return;
+
+	short bin = scanBinIndex(angle);
+
+	if( scanBinCount[bin] == 0 || range < scanBinMin[bin] )
+		scanBinMin[bin] = range;
+
+	// keep the newest samples, oldest is overwritten
+	scanBinSamples[ bin * SCAN_BIN_SAMPLES
+									+ scanBinCount[bin] % SCAN_BIN_SAMPLES ] = range;
+
+	if( scanBinCount[bin] < 32767 )
+		scanBinCount[bin] += 1;
+} // end scanAddSample
+
+//==========================================================
+//	scanRangeMin
+//	Shortest range in the bin, -1 if the bin is empty
+//==========================================================
+short scanRangeMin(short bin)
+{
+	if( scanBinCount[bin] == 0 )
+		return -1;
+
+	return scanBinMin[bin];
+} // end scanRangeMin
+
+//==========================================================
+//	scanRangeMedian
+//	Median of the samples kept for the bin,
+//	-1 if the bin is empty
+//==========================================================
+short scanRangeMedian(short bin)
+{
+	short count = scanBinCount[bin];
+	if( count == 0 )
+		return -1;
+	if( count > SCAN_BIN_SAMPLES )
+		count = SCAN_BIN_SAMPLES;
+
+	// insertion sort a copy, there are only a few samples
+	short sorted[SCAN_BIN_SAMPLES];
+	for( int i = 0; i < count; i++ )
+	{
+		short value = scanBinSamples[bin * SCAN_BIN_SAMPLES + i];
+		int j = i;
+		while( j > 0 && sorted[j - 1] > value )
+		{
+			sorted[j] = sorted[j - 1];
+			j--;
+		}
+		sorted[j] = value;
+	}
+
+	return sorted[count / 2];
+} // end scanRangeMedian
+
+//==========================================================
+//	scanCount
+//	Number of echoes that fell into the bin
+//==========================================================
+short scanCount(short bin)
+{
+	return scanBinCount[bin];
+} // end scanCount
+
+//==========================================================
+//	scanRangeAt
+//	Median range in the world direction angle (degrees),
+//	-1 if nothing was seen there
+//==========================================================
+short scanRangeAt(float angle)
+{
+	return scanRangeMedian( scanBinIndex(angle) );
+} // end scanRangeAt
+
+//==========================================================
+//	scanSweepStart
+//	Clear the scan and start a full turn from the current
+//	heading
+//==========================================================
+void scanSweepStart()
+{
+	writeDebugStreamLine("scanSweepStart");
+
+	scanReset();
+	odometryUpdate();
+
+	scanTurned 					= 0.0;
+	scanHeadingLast 		= odomHeading;
+	scanSweepStartTime 	= nSysTime;
+	bScanFailed 				= false;
+
+	scanWheelStalled(false);
+
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		scanSampleCountLast[i] = sonarSampleCount[i];
+	}
+} // end scanSweepStart
+
+//==========================================================
+//	scanSweepStep
+//	One control tick of the sweep, every SCAN_CONTROL_PERIOD.
+//	The target turn grows at SCAN_RATE; the rotate speed is a
+//	feed forward plus a correction on how far the robot is
+//	behind or ahead of the target.
+//	Returns true once the robot has turned 360 degrees, or
+//	with bScanFailed set if a wheel IEC stopped counting.
+//==========================================================
+bool scanSweepStep()
+{
+	odometryUpdate();
+
+	scanTurned 			+= angleDifference(odomHeading, scanHeadingLast);
+	scanHeadingLast = odomHeading;
+
+	// add the echoes that arrived since the last tick
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		if( sonarSampleCount[i] != scanSampleCountLast[i] )
+		{
+			scanSampleCountLast[i] = sonarSampleCount[i];
+			scanAddSample( odomHeading + SCAN_SONAR_OFFSET[i], sonarRawGlobal[i] );
+		}
+	}
+
+	if( scanWheelStalled(true) )
+	{
+		moveStopReact();
+		writeDebugStreamLine("scanSweep IEC_ERROR_TIMEOUT");
+		bScanFailed = true;
+		return true;
+	}
+
+	if( scanTurned >= 360.0 )
+	{
+		moveStopReact();
+		writeDebugStreamLine("scanSweep done in %d ms", nSysTime - scanSweepStartTime);
+		return true;
+	}
+
+	float target = SCAN_RATE * (nSysTime - scanSweepStartTime) / 1000.0;
+	if( target > 360.0 )
+		target = 360.0;
+
+	float speed = SCAN_SPEED_FEED + SCAN_KP * (target - scanTurned);
+	if( speed > SCAN_SPEED_MAX )
+		speed = SCAN_SPEED_MAX;
+	else if( speed < 0.0 )
+		speed = 0.0;
+
+	// counter clockwise
+	moveMecanumReact( 0, 0, -(int)speed );
+
+	// ahead of the target the wheels may stand still
+	if( (int)speed == 0 )
+		scanWheelStalled(false);
+
+	return false;
+} // end scanSweepStep
+
+//==========================================================
+//	scanWheelStalled
+//	true if a wheel IEC has not changed for IEC_ERROR_TIMEOUT.
+//	bDriven false restarts the clock of every wheel, for
+//	times the wheels are not meant to turn.
+//==========================================================
+bool scanWheelStalled(bool bDriven)
+{
+	bool bStalled = false;
+
+	for( int i = 0; i < 4; i++ )
+	{
+		if( !bDriven || odomWheelTravel[i] != scanWheelLast[i] )
+		{
+			scanWheelLast[i] = odomWheelTravel[i];
+			scanWheelTime[i] = nSysTime;
+		}
+		else if( nSysTime - scanWheelTime[i] > IEC_ERROR_TIMEOUT )
+		{
+			bStalled = true;
+		}
+	}
+
+	return bStalled;
+} // end scanWheelStalled
@@ -0,0 +1,160 @@
+/*
+		SonarTracker.h
+		Range and range rate estimation for the four sonars.
+
+		Each sonar has an alpha-beta tracker that is fed the timestamped
+		samples from monitorSensors. The tracker smooths the range and
+		estimates how fast the range is changing:
+			sonarRangeGlobal[SONAR_XXX]	... filtered range, inches
+			sonarRateGlobal[SONAR_XXX]	... range rate, inches per second
+																			negative means the object is closing in
+
+		The raw sample and a running sample count are kept as well:
+			sonarRawGlobal[SONAR_XXX]			... last raw reading, inches
+			sonarSampleCount[SONAR_XXX]		... new readings so far
+
+		SensorValue is the last echo the firmware got, reading it again
+		before the next echo gives the same sample. Only a new reading
+		goes into the tracker, over the real time since the last one:
+		a value that changed, or one that has held for SONAR_ECHO_PERIOD
+		(by then the sonar has pinged again, the range just did not
+		change). Feeding the same sample again would pull the rate
+		toward 0. So sampling a sonar faster than SONAR_ECHO_PERIOD
+		gives no more readings, only a change seen sooner.
+
+		The VEX sonar reports -1 when no echo comes back. That is treated
+		as nothing in range (SONAR_MAX_RANGE, not moving).
+
+		A sonar the sampling plan turns off is forgotten
+		(sonarTrackerForget), so its last rate is not reported on.
+*/
+
+static float 	sonarRangeGlobal[SONAR_COUNT];
+static float 	sonarRateGlobal[SONAR_COUNT];
+static long 	sonarTimeGlobal[SONAR_COUNT];
+static bool 	bSonarTracking[SONAR_COUNT];
+static int 		sonarRawGlobal[SONAR_COUNT];
+static long 	sonarSampleCount[SONAR_COUNT];
+static long 	sonarReadTime[SONAR_COUNT];	// nSysTime of the last new reading
+
+// FUNCTION DECLARATIONS
+void 	sonarTrackerReset();
+void 	sonarTrackerForget(short sonar);
+void 	sonarTrackerUpdate(short sonar, int rawValue, long now);
+long 	sonarTimeToContact(short sonar);
+bool 	sonarThreat(short sonar, int threshold);
+
+//==========================================================
+//	sonarTrackerReset
+//	Forget all targets
+//==========================================================
+void sonarTrackerReset()
+{
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		sonarTrackerForget(i);
+		sonarRawGlobal[i] 	= -1;
+		sonarSampleCount[i] = 0;
+		sonarReadTime[i] 		= nSysTime;
+	}
+} // end sonarTrackerReset
+
+//==========================================================
+//	sonarTrackerForget
+//	Drop the target of one sonar: nothing in range, not
+//	moving, until its next reading
+//==========================================================
+void sonarTrackerForget(short sonar)
+{
+	sonarRangeGlobal[sonar] = SONAR_MAX_RANGE;
+	sonarRateGlobal[sonar] 	= 0.0;
+	sonarTimeGlobal[sonar] 	= nSysTime;
+	bSonarTracking[sonar] 	= false;
+} // end sonarTrackerForget
+
+//==========================================================
+//	sonarTrackerUpdate
+//	Feed one raw sonar sample, taken at time now (nSysTime).
+//	The same reading again is skipped.
+//==========================================================
+void sonarTrackerUpdate(short sonar, int rawValue, long now)
+{
+	if( sonarSampleCount[sonar] > 0 && rawValue == sonarRawGlobal[sonar] &&
+			now - sonarReadTime[sonar] < SONAR_ECHO_PERIOD )
+		return;
+
+	sonarRawGlobal[sonar] 		= rawValue;
+	sonarSampleCount[sonar] 	+= 1;
+	sonarReadTime[sonar] 			= now;
+
+	// no echo, nothing in range
+	if( rawValue < 0 )
+	{
+		sonarRangeGlobal[sonar] = SONAR_MAX_RANGE;
+		sonarRateGlobal[sonar] 	= 0.0;
+		sonarTimeGlobal[sonar] 	= now;
+		bSonarTracking[sonar] 	= false;
+		return;
+	}
+
+	float measured = rawValue;
+
+	// first sample of a new target
+	if( !bSonarTracking[sonar] )
+	{
+		sonarRangeGlobal[sonar] = measured;
+		sonarRateGlobal[sonar] 	= 0.0;
+		sonarTimeGlobal[sonar] 	= now;
+		bSonarTracking[sonar] 	= true;
+		return;
+	}
+
+	float dt = (now - sonarTimeGlobal[sonar]) / 1000.0;
+	if( dt <= 0.0 )
+		return;
+
+	// predict where the target is now
+	float predicted = sonarRangeGlobal[sonar] + sonarRateGlobal[sonar] * dt;
+	float residual 	= measured - predicted;
+
+	// a big jump is a different object, not a fast one
+	if( abs(residual) > SONAR_GATE )
+	{
+		sonarRangeGlobal[sonar] = measured;
+		sonarRateGlobal[sonar] 	= 0.0;
+		sonarTimeGlobal[sonar] 	= now;
+		return;
+	}
+
+	// correct the prediction
+	sonarRangeGlobal[sonar] = predicted + SONAR_ALPHA * residual;
+	sonarRateGlobal[sonar] 	= sonarRateGlobal[sonar] + (SONAR_BETA / dt) * residual;
+	sonarTimeGlobal[sonar] 	= now;
+} // end sonarTrackerUpdate
+
+//==========================================================
+//	sonarTimeToContact
+//	Milliseconds until the object reaches the sonar at
+//	its current closing speed.
+//	SONAR_TTC_NONE if nothing is closing in.
+//==========================================================
+long sonarTimeToContact(short sonar)
+{
+	if( sonarRateGlobal[sonar] > -SONAR_MIN_CLOSING )
+		return SONAR_TTC_NONE;
+
+	return (long)( sonarRangeGlobal[sonar] * 1000.0 / -sonarRateGlobal[sonar] );
+} // end sonarTimeToContact
+
+//==========================================================
+//	sonarThreat
+//	true if an object is closer than threshold inches,
+//	or will be touching the robot within DEFENSE_TTC_THRESHOLD
+//==========================================================
+bool sonarThreat(short sonar, int threshold)
+{
+	if( sonarRangeGlobal[sonar] < threshold )
+		return true;
+
+	return sonarTimeToContact(sonar) < DEFENSE_TTC_THRESHOLD;
+} // end sonarThreat
@@ -0,0 +1,263 @@
+/*
+		Telemetry.h
+		The numbers behind the LCD telemetry pages (TELEMETRY in
+		SentinalGlobals.h), each worked out over the last
+		TELEMETRY_PERIOD by telemetryUpdate:
+			wheel speeds			... odomWheelTravel differences, so the
+													IEC resets of the moveXXX functions
+													do not matter
+			loop period				... time between mode ticks, from
+													telemetryTick, with the average and
+													largest distance from modePeriod
+			task load					... taskBusyTime differences, see below
+			sonar rate				... sonarSampleCount differences, new
+													readings only (SonarTracker.h), so the
+													echo rate and not how often the
+													sampling plan reads the sonar
+
+		Task load: the tasks wake on millisecond ticks and are done
+		well within one, so timing them with nSysTime reads 0. Instead
+		telemetryIdle counts as fast as it can below every timed task,
+		so it only counts in the time they leave free. Each millisecond
+		in which no timed task ran gives the count of a free
+		millisecond, telemetryIdleRate. In any other the counts
+		missing from it are the time the tasks that set bTaskRan took.
+		The tasks often wake at the same tick, so that time is split
+		between them in proportion to what each one usually takes,
+		telemetryTaskCost, which in turn follows the shares it gets.
+		A task that often runs alone or with tasks already known
+		soon gets its own cost. Low priority tasks that are not
+		timed (logDrain) share the time with telemetryIdle and show
+		in no page.
+
+		The tasks set bTaskRan on every run, whether a page is shown
+		or not; only telemetryIdle clears it. The rest, telemetryTick
+		and telemetryIdle included, runs only while a page is shown.
+*/
+
+static long 	telemetryTimeLast 				= 0;
+static float 	telemetryWheelLast[4];
+static float 	telemetryBusyLast[TASK_COUNT];
+static long 	telemetryIdleRate 				= 0;	// counts in a free millisecond
+static float 	telemetryTaskCost[TASK_COUNT];		// ms per run, see telemetryIdle
+static long 	telemetrySonarLast[SONAR_COUNT];
+
+// mode ticks since the last update
+static long 	telemetryTickLast 				= 0;
+static long 	telemetryTickCount 				= 0;
+static long 	telemetryTickSum 					= 0;	// ms between ticks
+static long 	telemetryTickOffSum 			= 0;	// ms off the period
+static long 	telemetryTickOffMax 			= 0;
+
+// FUNCTION DECLARATIONS
+void telemetryTickRestart();
+void telemetryTick(int period);
+void telemetryUpdate();
+task telemetryIdle();
+void telemetryNextPage();
+
+//==========================================================
+//	telemetryTickRestart
+//	A new mode starts ticking, do not time the gap
+//==========================================================
+void telemetryTickRestart()
+{
+	telemetryTickLast = 0;
+} // end telemetryTickRestart
+
+//==========================================================
+//	telemetryTick
+//	Called by the scheduler on every mode tick, period is the
+//	mode's tick period in ms
+//==========================================================
+void telemetryTick(int period)
+{
+	long now = nSysTime;
+
+	if( telemetryTickLast != 0 )
+	{
+		long interval = now - telemetryTickLast;
+		long off 			= interval - period;
+		if( off < 0 )
+			off = -off;
+
+		telemetryTickCount 	+= 1;
+		telemetryTickSum 		+= interval;
+		telemetryTickOffSum += off;
+		if( off > telemetryTickOffMax )
+			telemetryTickOffMax = off;
+	}
+
+	telemetryTickLast = now;
+} // end telemetryTick
+
+//==========================================================
+//	telemetryUpdate
+//	Work out every page's numbers over the time since the
+//	last call
+//==========================================================
+void telemetryUpdate()
+{
+	long now 		= nSysTime;
+	long elapsed = now - telemetryTimeLast;
+	telemetryTimeLast = now;
+	if( elapsed <= 0 )
+		return;
+
+	for( int i = 0; i < 4; i++ )
+	{
+		telemetryWheelSpeed[i] 	= (odomWheelTravel[i] - telemetryWheelLast[i]) * 1000.0 / elapsed;
+		telemetryWheelLast[i] 	= odomWheelTravel[i];
+	}
+
+	for( int i = 0; i < TASK_COUNT; i++ )
+	{
+		telemetryTaskLoad[i] 	= (short)( (taskBusyTime[i] - telemetryBusyLast[i]) * 100 / elapsed );
+		telemetryBusyLast[i] 	= taskBusyTime[i];
+	}
+
+	for( int i = 0; i < SONAR_COUNT; i++ )
+	{
+		telemetrySonarRate[i] = (sonarSampleCount[i] - telemetrySonarLast[i]) * 1000.0 / elapsed;
+		telemetrySonarLast[i] = sonarSampleCount[i];
+	}
+
+	if( telemetryTickCount > 0 )
+	{
+		telemetryLoopPeriod 		= (float)telemetryTickSum / telemetryTickCount;
+		telemetryLoopJitter 		= (float)telemetryTickOffSum / telemetryTickCount;
+		telemetryLoopJitterMax 	= telemetryTickOffMax;
+	}
+	else
+	{
+		telemetryLoopPeriod 		= 0.0;
+		telemetryLoopJitter 		= 0.0;
+		telemetryLoopJitterMax 	= 0.0;
+	}
+	telemetryTickCount 	= 0;
+	telemetryTickSum 		= 0;
+	telemetryTickOffSum = 0;
+	telemetryTickOffMax = 0;
+} // end telemetryUpdate
+
+//==========================================================
+//	telemetryIdle
+//	Counts in the time the timed tasks leave free and adds
+//	the time they took to taskBusyTime, once per millisecond.
+//	Start at kLowPriority, below every timed task.
+//==========================================================
+task telemetryIdle()
+{
+	long 	msLast 		= nSysTime;
+	long 	now 			= 0;
+	long 	count 		= 0;
+	bool 	bRan[TASK_COUNT];			// ran at the msLast tick
+	bool 	bCharge[TASK_COUNT];	// ran in the burst being counted
+	bool 	bFirst 		= true;	// started part way into a millisecond
+	short chargeCount = 0;
+	float busy 			= 0.0;		// ms of the burst so far
+	float costSum 	= 0.0;
+	float share 		= 0.0;
+
+	for( int i = 0; i < TASK_COUNT; i++ )
+	{
+		bRan[i] 							= false;
+		bCharge[i] 						= false;
+		telemetryTaskCost[i] 	= 1.0;	// even shares to start with
+	}
+
+	while( true )
+	{
+		now = nSysTime;
+		if( now != msLast )
+		{
+			// bTaskRan is set by the tasks that ran at this tick,
+			// and if the count stopped for more than a millisecond
+			// by those that kept it stopped too
+			chargeCount = 0;
+			hogCPU();
+			for( int i = 0; i < TASK_COUNT; i++ )
+			{
+				if( bRan[i] || ( now - msLast > 1 && bTaskRan[i] ) )
+					bCharge[i] = true;
+				bRan[i] 		= bTaskRan[i];
+				bTaskRan[i] = false;
+				if( bCharge[i] )
+					chargeCount++;
+			}
+			releaseCPU();
+
+			if( chargeCount == 0 )
+			{
+				if( !bFirst && now - msLast == 1 && count > telemetryIdleRate )
+					telemetryIdleRate = count;
+			}
+			else if( !bFirst && telemetryIdleRate > 0 )
+			{
+				busy += (float)( (now - msLast) * telemetryIdleRate - count ) / telemetryIdleRate;
+			}
+
+			// a burst that stopped the count for longer ends in the
+			// millisecond after, charge it once it is whole
+			if( chargeCount > 0 && now - msLast == 1 )
+			{
+				if( busy < 0.0 )
+					busy = 0.0;
+
+				costSum = 0.0;
+				for( int i = 0; i < TASK_COUNT; i++ )
+				{
+					if( bCharge[i] )
+						costSum += telemetryTaskCost[i];
+				}
+
+				for( int i = 0; i < TASK_COUNT; i++ )
+				{
+					if( !bCharge[i] )
+						continue;
+
+					share = busy / chargeCount;
+					if( costSum > 0.0 )
+						share = busy * telemetryTaskCost[i] / costSum;
+
+					taskBusyTime[i] 			+= share;
+					telemetryTaskCost[i] 	+= (share - telemetryTaskCost[i]) * TELEMETRY_COST_GAIN;
+					bCharge[i] 						= false;
+				}
+				busy = 0.0;
+			}
+
+			bFirst 	= false;
+			msLast 	= now;
+			count 	= 0;
+		}
+
+		count++;
+	} // end while
+} // end telemetryIdle
+
+//==========================================================
+//	telemetryNextPage
+//	Go to the next page, off after the last one. The first
+//	numbers of a page cover the time since the page before.
+//==========================================================
+void telemetryNextPage()
+{
+	if( telemetryPage >= TELEMETRY_PAGES )
+	{
+		telemetryPage = TELEMETRY_OFF;
+		stopTask(telemetryIdle);
+	}
+	else
+	{
+		if( telemetryPage == TELEMETRY_OFF )
+		{
+			telemetryTickRestart();
+			startTask(telemetryIdle, kLowPriority);
+		}
+		telemetryPage += 1;
+	}
+
+	telemetryUpdate();
+	writeDebugStreamLine("telemetry page %d", telemetryPage);
+} // end telemetryNextPage
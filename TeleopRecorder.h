@@ -0,0 +1,460 @@
+/*
+		TeleopRecorder.h
+		Record a remoteControlMode session and drive it again in
+		replayMode.
+
+		remoteControlStep hands the speeds it drives (after the sonar
+		assist) to recordCommand on every tick. Only changes are kept,
+		as a stream of bytes in recordBuffer. Every record starts with
+		one header byte, the top 2 bits are the record type:
+			COMMAND		00 fsr ttt	+ one byte for each of f, s, r set:
+												the change of forward, strafe, rotate in
+												RECORD_SPEED_STEP units
+			WAIT			01 tttttt		nothing changed
+			POSE			10 tttttt		+ 3 bytes: change of x, y in
+												RECORD_POSE_STEP inches and of the heading
+												in degrees, since the last POSE
+			END				11 000000
+		t is the time since the previous record in RECORD_TIME_UNIT ms.
+		A longer gap is filled with WAIT records first.
+
+		POSE snapshots come from odometry (the wheel IECs) every
+		RECORD_POSE_PERIOD, and only when the robot has moved. They are
+		relative to the pose the recording started at, turned so that
+		it faces DIRECTION_FRONT, so a replay can start anywhere.
+
+		Size: a stick moving on one axis costs 2 bytes per change,
+		a snapshot 4 bytes, standing still about 1 byte a second.
+		Continuous driving takes 25 to 30 bytes a second, so the
+		6 KB buffer holds 3 to 4 minutes of it, more with pauses.
+		The Cortex has no file storage for user programs: the
+		DUMP RECORD menu entry starts the low priority recordDump
+		task, which writes the buffer to the debug stream as a byte
+		list that can be saved or pasted back into the program. It
+		writes one line every RECORD_DUMP_PERIOD, so the scheduler
+		never waits on the debug stream.
+
+		Replay runs the commands on the recorded time line. At each
+		POSE the robot compares its own pose against the recording,
+		rotated onto the replay start pose, and adds a proportional
+		correction to the commands until the next POSE.
+*/
+
+static const short 	RECORD_COMMAND 	= 0;
+static const short 	RECORD_WAIT 		= 1;
+static const short 	RECORD_POSE 		= 2;
+static const short 	RECORD_END 			= 3;
+
+static ubyte 	recordBuffer[RECORD_BUFFER_SIZE];
+static int 		recordLength 			= 0;
+static bool 	bRecording 				= false;
+static bool 	bRecordFull 			= false;
+
+//==========================================================
+//  RECORDER STATE
+//==========================================================
+static long 	recordStartTime 	= 0;
+static long 	recordTimeLast 		= 0;	// RECORD_TIME_UNITs, last record
+static long 	recordPoseTime 		= 0;	// ms, next snapshot due
+static short 	recordSpeed[3];					// forward, strafe, rotate in steps
+static int 		recordPose[3];					// x, y, heading in recorded steps
+static float 	recordStartX 			= 0.0;
+static float 	recordStartY 			= 0.0;
+static float 	recordStartHeading = 90.0;
+
+//==========================================================
+//  REPLAY STATE
+//==========================================================
+static int 		replayCursor 			= 0;
+static long 	replayClock 			= 0;	// RECORD_TIME_UNITs, last record run
+static long 	replayStartTime 	= 0;
+static bool 	bReplayDone 			= true;
+static short 	replaySpeed[3];
+static int 		replayPose[3];
+static float 	replayCorrection[3];
+static float 	replayStartX 			= 0.0;
+static float 	replayStartY 			= 0.0;
+static float 	replayStartHeading = 90.0;
+static float 	replayErrorLast 	= 0.0;	// inches, at the last snapshot
+
+// FUNCTION DECLARATIONS
+void 	recordStart();
+void 	recordStop();
+bool 	recordPut(ubyte value);
+bool 	recordHeader(short type, short bits, short length, long now, long maxTime);
+void 	recordCommand(int forward, int strafe, int rotate);
+void 	recordPoseSnapshot();
+task 	recordDump();
+int 	recordSigned(ubyte value);
+void 	replayStart();
+void 	replayPoseCorrection();
+bool 	replayStep();
+
+//==========================================================
+//	recordStart
+//	Start a new recording from the current pose, the last
+//	one is dropped
+//==========================================================
+void recordStart()
+{
+	odometryUpdate();
+
+	recordLength 			= 0;
+	bRecordFull 			= false;
+	recordStartTime 	= nSysTime;
+	recordTimeLast 		= 0;
+	recordPoseTime 		= nSysTime + RECORD_POSE_PERIOD;
+	recordStartX 			= odomX;
+	recordStartY 			= odomY;
+	recordStartHeading = odomHeading;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		recordSpeed[i] 	= 0;
+		recordPose[i] 	= 0;
+	}
+
+	bRecording = true;
+} // end recordStart
+
+//==========================================================
+//	recordStop
+//	Close the recording with a last snapshot
+//==========================================================
+void recordStop()
+{
+	if( !bRecording )
+		return;
+
+	recordCommand(0, 0, 0);
+	recordPoseSnapshot();
+
+	// recordPut always leaves room for END
+	recordBuffer[recordLength] 	= RECORD_END << 6;
+	recordLength 							+= 1;
+	bRecording 									= false;
+
+	writeDebugStreamLine("record: %d bytes in %d ms, full=%d",
+												recordLength, nSysTime - recordStartTime, bRecordFull);
+} // end recordStop
+
+//==========================================================
+//	recordPut
+//	Append one byte, false once the buffer is full. The
+//	last byte is kept for END, recordHeader checks the room
+//	for a whole record first.
+//==========================================================
+bool recordPut(ubyte value)
+{
+	if( recordLength >= RECORD_BUFFER_SIZE - 1 )
+	{
+		bRecordFull = true;
+		return false;
+	}
+
+	recordBuffer[recordLength] = value;
+	recordLength += 1;
+	return true;
+} // end recordPut
+
+//==========================================================
+//	recordHeader
+//	Write the header of a record at time now (RECORD_TIME_UNITs
+//	since the start), with WAIT records first if the gap is
+//	longer than maxTime. bits go between the type and the time.
+//	false if the record with its length data bytes does not
+//	fit, so a record is never cut short.
+//==========================================================
+bool recordHeader(short type, short bits, short length, long now, long maxTime)
+{
+	long gap = now - recordTimeLast;
+
+	long waits = 0;
+	if( gap > maxTime )
+		waits = (gap - maxTime + 62) / 63;
+	if( recordLength + waits + 1 + length > RECORD_BUFFER_SIZE - 1 )
+	{
+		bRecordFull = true;
+		return false;
+	}
+
+	while( gap > maxTime )
+	{
+		long wait = gap - maxTime;
+		if( wait > 63 )
+			wait = 63;
+		recordPut( (RECORD_WAIT << 6) | wait );
+		gap -= wait;
+	}
+
+	recordTimeLast = now;
+	recordPut( (type << 6) | (bits << 3) | gap );
+	return true;
+} // end recordHeader
+
+//==========================================================
+//	recordCommand
+//	Called by remoteControlStep on every tick with the speeds
+//	it drives. Costs a few compares unless a speed changed.
+//==========================================================
+void recordCommand(int forward, int strafe, int rotate)
+{
+	if( !bRecording || bRecordFull )
+		return;
+
+	short speed[3];
+	speed[0] = (short)floor( (float)forward / RECORD_SPEED_STEP + 0.5 );
+	speed[1] = (short)floor( (float)strafe / RECORD_SPEED_STEP + 0.5 );
+	speed[2] = (short)floor( (float)rotate / RECORD_SPEED_STEP + 0.5 );
+
+	short mask 		= 0;
+	short length 	= 0;
+	for( int i = 0; i < 3; i++ )
+	{
+		if( speed[i] != recordSpeed[i] )
+		{
+			mask 		|= 4 >> i;
+			length 	+= 1;
+		}
+	}
+
+	if( mask != 0 )
+	{
+		long now = (nSysTime - recordStartTime) / RECORD_TIME_UNIT;
+		if( !recordHeader(RECORD_COMMAND, mask, length, now, 7) )
+			return;
+
+		// a step is at most 127 / RECORD_SPEED_STEP, the change fits a byte
+		for( int i = 0; i < 3; i++ )
+		{
+			if( (mask & (4 >> i)) == 0 )
+				continue;
+			recordPut( (ubyte)( (speed[i] - recordSpeed[i]) & 0xFF ) );
+			recordSpeed[i] = speed[i];
+		}
+	}
+
+	if( nSysTime >= recordPoseTime )
+	{
+		recordPoseTime = nSysTime + RECORD_POSE_PERIOD;
+		recordPoseSnapshot();
+	}
+} // end recordCommand
+
+//==========================================================
+//	recordPoseSnapshot
+//	Record where odometry has the robot, relative to the
+//	start of the recording, if it moved
+//==========================================================
+void recordPoseSnapshot()
+{
+	// turn the start heading onto DIRECTION_FRONT
+	float angle = degreesToRadians(DIRECTION_FRONT - recordStartHeading);
+	float dx 		= odomX - recordStartX;
+	float dy 		= odomY - recordStartY;
+
+	int pose[3];
+	pose[0] = (int)floor( (dx * cos(angle) - dy * sin(angle)) / RECORD_POSE_STEP + 0.5 );
+	pose[1] = (int)floor( (dx * sin(angle) + dy * cos(angle)) / RECORD_POSE_STEP + 0.5 );
+	pose[2] = recordPose[2] + (int)floor( angleDifference(odomHeading - recordStartHeading,
+																												recordPose[2]) + 0.5 );
+
+	int change[3];
+	bool bMoved = false;
+	for( int i = 0; i < 3; i++ )
+	{
+		// a bigger change is caught up with in the next snapshots
+		change[i] = pose[i] - recordPose[i];
+		if( change[i] > 127 )
+			change[i] = 127;
+		else if( change[i] < -127 )
+			change[i] = -127;
+
+		if( change[i] != 0 )
+			bMoved = true;
+	}
+
+	if( !bMoved )
+		return;
+
+	long now = (nSysTime - recordStartTime) / RECORD_TIME_UNIT;
+	if( !recordHeader(RECORD_POSE, 0, 3, now, 63) )
+		return;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		recordPut( (ubyte)( change[i] & 0xFF ) );
+		recordPose[i] += change[i];
+	}
+} // end recordPoseSnapshot
+
+//==========================================================
+//	recordDump
+//	Write the recording to the debug stream, 16 bytes a line,
+//	one line every RECORD_DUMP_PERIOD. Start at kLowPriority.
+//	Gives up if a new recording starts meanwhile.
+//==========================================================
+task recordDump()
+{
+	if( bRecording )
+	{
+		writeDebugStreamLine("record: still recording, leave remote control first");
+		return;
+	}
+
+	writeDebugStreamLine("record: %d bytes", recordLength);
+	for( int i = 0; i < recordLength; i++ )
+	{
+		writeDebugStream("0x%02x,", recordBuffer[i]);
+		if( (i % 16) == 15 )
+		{
+			writeDebugStreamLine("");
+			wait1Msec(RECORD_DUMP_PERIOD);
+			if( bRecording )
+			{
+				writeDebugStreamLine("record: dump cut short, recording again");
+				return;
+			}
+		}
+	}
+	writeDebugStreamLine("");
+} // end recordDump
+
+//==========================================================
+//	recordSigned
+//	A recorded byte back to -128 .. 127
+//==========================================================
+int recordSigned(ubyte value)
+{
+	if( value > 127 )
+		return value - 256;
+
+	return value;
+} // end recordSigned
+
+//==========================================================
+//	replayStart
+//	Drive the recording again from the current pose
+//==========================================================
+void replayStart()
+{
+	odometryUpdate();
+
+	replayCursor 			= 0;
+	replayClock 			= 0;
+	replayStartTime 	= nSysTime;
+	replayStartX 			= odomX;
+	replayStartY 			= odomY;
+	replayStartHeading = odomHeading;
+	replayErrorLast 	= 0.0;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		replaySpeed[i] 			= 0;
+		replayPose[i] 			= 0;
+		replayCorrection[i] = 0.0;
+	}
+
+	bReplayDone = ( recordLength == 0 || bRecording );
+	writeDebugStreamLine("replayStart %d bytes", recordLength);
+} // end replayStart
+
+//==========================================================
+//	replayPoseCorrection
+//	Compare the pose against the snapshot just read and set
+//	the correction held until the next one
+//==========================================================
+void replayPoseCorrection()
+{
+	// the recorded pose, turned onto the replay start pose
+	float angle = degreesToRadians(replayStartHeading - DIRECTION_FRONT);
+	float x 		= replayPose[0] * RECORD_POSE_STEP;
+	float y 		= replayPose[1] * RECORD_POSE_STEP;
+
+	float errorX = replayStartX + x * cos(angle) - y * sin(angle) - odomX;
+	float errorY = replayStartY + x * sin(angle) + y * cos(angle) - odomY;
+	float errorHeading = angleDifference(replayStartHeading + replayPose[2], odomHeading);
+
+	replayErrorLast = sqrt(errorX * errorX + errorY * errorY);
+
+	// into the robot frame, see odometryIntegrate
+	float heading = degreesToRadians(odomHeading);
+	replayCorrection[0] = REPLAY_KP * ( errorX * cos(heading) + errorY * sin(heading) );
+	replayCorrection[1] = REPLAY_KP * ( errorX * sin(heading) - errorY * cos(heading) );
+
+	// behind counter clockwise: turn counter clockwise
+	replayCorrection[2] = -REPLAY_HEADING_KP * errorHeading;
+
+	for( int i = 0; i < 3; i++ )
+	{
+		if( replayCorrection[i] > REPLAY_CORRECTION_MAX )
+			replayCorrection[i] = REPLAY_CORRECTION_MAX;
+		else if( replayCorrection[i] < -REPLAY_CORRECTION_MAX )
+			replayCorrection[i] = -REPLAY_CORRECTION_MAX;
+	}
+} // end replayPoseCorrection
+
+//==========================================================
+//	replayStep
+//	One tick of the replay: run every record that is due and
+//	drive the recorded speeds plus the correction.
+//	Returns true once the recording is done.
+//==========================================================
+bool replayStep()
+{
+	if( bReplayDone )
+	{
+		moveStopReact();
+		return true;
+	}
+
+	long now = (nSysTime - replayStartTime) / RECORD_TIME_UNIT;
+
+	while( replayCursor < recordLength )
+	{
+		ubyte header 	= recordBuffer[replayCursor];
+		short type 		= header >> 6;
+		long 	time 		= replayClock + (header & 0x3F);
+		if( type == RECORD_COMMAND )
+			time = replayClock + (header & 0x07);
+
+		if( time > now )
+			break;
+
+		replayClock 	= time;
+		replayCursor += 1;
+
+		if( type == RECORD_COMMAND )
+		{
+			for( int i = 0; i < 3; i++ )
+			{
+				if( (header & (0x20 >> i)) == 0 )
+					continue;
+				replaySpeed[i] += recordSigned( recordBuffer[replayCursor] );
+				replayCursor += 1;
+			}
+		}
+		else if( type == RECORD_POSE )
+		{
+			for( int i = 0; i < 3; i++ )
+			{
+				replayPose[i] += recordSigned( recordBuffer[replayCursor] );
+				replayCursor += 1;
+			}
+			replayPoseCorrection();
+		}
+		else if( type == RECORD_END )
+		{
+			moveStopReact();
+			writeDebugStreamLine("replay done in %d ms, %f in off",
+														nSysTime - replayStartTime, replayErrorLast);
+			bReplayDone = true;
+			return true;
+		}
+	} // end while
+
+	moveMecanumReact( (int)( replaySpeed[0] * RECORD_SPEED_STEP + replayCorrection[0] ),
+										(int)( replaySpeed[1] * RECORD_SPEED_STEP + replayCorrection[1] ),
+										(int)( replaySpeed[2] * RECORD_SPEED_STEP + replayCorrection[2] ) );
+	return false;
+} // end replayStep
@@ -0,0 +1,268 @@
+/*
+		WallFollower.h
+		Wall following engine for wallFollowMode, using the side sonars.
+
+		The wall is on the side whose sonar sees the nearer wall when the
+		mode starts (the right side if neither sees one). Every
+		WALL_CONTROL_PERIOD the engine
+		-	runs a PID on the filtered side range (SonarTracker.h) against
+			WALL_DISTANCE; the derivative is the tracker's range rate
+		-	corrects with a pure strafe, the mecanum wheels slide sideways
+			so the chassis never has to yaw toward the wall
+		-	drives forward at WALL_SPEED_FORWARD while holding the heading
+			from odometry
+		A wall ahead (front sonar) is an inside corner: the robot turns
+		90 degrees in place, away from the wall, and follows the new one.
+		If the wall ends, the robot creeps on for WALL_LOST_TIMEOUT and
+		then stops until a wall is seen again.
+
+		Straightness and speed metrics, while tracking:
+			wallErrorRMS				... distance from WALL_DISTANCE, inches
+			wallHeadingErrorMax	... largest heading deviation, degrees
+			wallSpeed						... inches per second along the wall
+		The metrics use the sonar and odometry, so they count the tilt
+		of the beam after a corner and a dropped echo as error.
+*/
+
+// wall follower states
+static const short WALL_STATE_TRACKING 	= 0;
+static const short WALL_STATE_TURNING 	= 1;
+static const short WALL_STATE_SEARCHING = 2;
+static const short WALL_STATE_LOST 			= 3;
+
+//==========================================================
+//  WALL FOLLOWER STATE
+//==========================================================
+static short 	wallState 						= WALL_STATE_TRACKING;
+static short 	wallSide 							= SONAR_RIGHT;
+static float 	wallHeading 					= 90.0;	// heading held
+static float 	wallErrorIntegral 		= 0.0;
+static long 	wallLostTime 					= 0;
+
+//==========================================================
+//  WALL FOLLOWER METRICS
+//==========================================================
+static float 	wallErrorSumSquares 	= 0.0;
+static long 	wallErrorSamples 			= 0;
+static float 	wallErrorMax 					= 0.0;
+static float 	wallHeadingErrorMax 	= 0.0;
+static float 	wallDistance 					= 0.0;	// inches driven while tracking
+static long 	wallTrackTime 				= 0;		// ms spent tracking
+static float 	wallPoseLastX 				= 0.0;
+static float 	wallPoseLastY 				= 0.0;
+static long 	wallTimeLast 					= 0;
+static short 	wallCornerCount 			= 0;
+
+// FUNCTION DECLARATIONS
+void 	wallFollowerReset();
+bool 	wallInRange(short sonar);
+short wallFollowerStep();
+float wallErrorRMS();
+float wallSpeed();
+void 	wallFollowerReport();
+
+//==========================================================
+//	wallFollowerReset
+//	Pick the wall, hold the current heading and clear the
+//	controller and metrics before a new run
+//==========================================================
+void wallFollowerReset()
+{
+	odometryUpdate();
+
+	wallSide = SONAR_RIGHT;
+	if( wallInRange(SONAR_LEFT) &&
+			( !wallInRange(SONAR_RIGHT) ||
+				sonarRangeGlobal[SONAR_LEFT] < sonarRangeGlobal[SONAR_RIGHT] ) )
+	{
+		wallSide = SONAR_LEFT;
+	}
+
+	wallState 					= WALL_STATE_TRACKING;
+	wallHeading 				= odomHeading;
+	wallErrorIntegral 	= 0.0;
+	wallLostTime 				= nSysTime;
+
+	wallErrorSumSquares = 0.0;
+	wallErrorSamples 		= 0;
+	wallErrorMax 				= 0.0;
+	wallHeadingErrorMax = 0.0;
+	wallDistance 				= 0.0;
+	wallTrackTime 			= 0;
+	wallPoseLastX 			= odomX;
+	wallPoseLastY 			= odomY;
+	wallTimeLast 				= nSysTime;
+	wallCornerCount 		= 0;
+
+	writeDebugStreamLine("wallFollowerReset side=%d", wallSide);
+} // end wallFollowerReset
+
+//==========================================================
+//	wallInRange
+//	true if the sonar sees a wall close enough to follow
+//==========================================================
+bool wallInRange(short sonar)
+{
+	return bSonarTracking[sonar] && sonarRangeGlobal[sonar] < WALL_LOST_RANGE;
+} // end wallInRange
+
+//==========================================================
+//	wallFollowerStep
+//	One control tick of the wall follower, every
+//	WALL_CONTROL_PERIOD. Returns the wall follower state.
+//==========================================================
+short wallFollowerStep()
+{
+	long now = nSysTime;
+
+	// + toward the wall
+	short sideSign = 1;
+	if( wallSide == SONAR_LEFT )
+		sideSign = -1;
+
+	// turned counter clockwise of the held heading: turn clockwise
+	float headingError 	= angleDifference(odomHeading, wallHeading);
+	float rotate 				= MOVEMENT_HEADING_KP * headingError;
+
+	if( wallState == WALL_STATE_TURNING )
+	{
+		if( abs(headingError) < WALL_TURN_TOLERANCE )
+		{
+			wallErrorIntegral = 0.0;
+			wallPoseLastX 		= odomX;
+			wallPoseLastY 		= odomY;
+			wallState 				= WALL_STATE_TRACKING;
+		}
+		else
+		{
+			if( rotate > WALL_TURN_SPEED_MAX )
+				rotate = WALL_TURN_SPEED_MAX;
+			else if( rotate < -WALL_TURN_SPEED_MAX )
+				rotate = -WALL_TURN_SPEED_MAX;
+			else if( rotate > 0.0 && rotate < WALL_TURN_SPEED_MIN )
+				rotate = WALL_TURN_SPEED_MIN;
+			else if( rotate < 0.0 && rotate > -WALL_TURN_SPEED_MIN )
+				rotate = -WALL_TURN_SPEED_MIN;
+
+			moveMecanumReact( 0, 0, (int)rotate );
+		}
+
+		wallTimeLast = now;
+		return wallState;
+	}
+
+	// inside corner: turn away from the wall and follow the new one
+	if( sonarThreat(SONAR_FRONT, WALL_FRONT_THRESHOLD) )
+	{
+		wallHeading += 90.0 * sideSign;
+		wallCornerCount += 1;
+		wallState = WALL_STATE_TURNING;
+		moveStopReact();
+		wallTimeLast = now;
+		return wallState;
+	}
+
+	if( wallInRange(wallSide) )
+	{
+		// + too far from the wall
+		float error = sonarRangeGlobal[wallSide] - WALL_DISTANCE;
+
+		wallErrorIntegral += error;
+		if( wallErrorIntegral > WALL_INTEGRAL_LIMIT )
+			wallErrorIntegral = WALL_INTEGRAL_LIMIT;
+		else if( wallErrorIntegral < -WALL_INTEGRAL_LIMIT )
+			wallErrorIntegral = -WALL_INTEGRAL_LIMIT;
+
+		// the tracker's range rate is the filtered derivative
+		float strafe = WALL_KP * error
+									+ WALL_KI * wallErrorIntegral
+									+ WALL_KD * sonarRateGlobal[wallSide];
+		if( strafe > WALL_STRAFE_MAX )
+			strafe = WALL_STRAFE_MAX;
+		else if( strafe < -WALL_STRAFE_MAX )
+			strafe = -WALL_STRAFE_MAX;
+
+		moveMecanumReact( WALL_SPEED_FORWARD, (int)( sideSign * strafe ), (int)rotate );
+
+		// straightness and speed metrics
+		if( wallState == WALL_STATE_TRACKING )
+		{
+			float dx = odomX - wallPoseLastX;
+			float dy = odomY - wallPoseLastY;
+			wallDistance 	+= sqrt(dx * dx + dy * dy);
+			wallTrackTime += now - wallTimeLast;
+		}
+		wallErrorSumSquares += error * error;
+		wallErrorSamples 		+= 1;
+		if( abs(error) > wallErrorMax )
+			wallErrorMax = abs(error);
+		if( abs(headingError) > wallHeadingErrorMax )
+			wallHeadingErrorMax = abs(headingError);
+
+		wallPoseLastX = odomX;
+		wallPoseLastY = odomY;
+		wallTimeLast 	= now;
+		wallLostTime 	= now;
+		wallState 		= WALL_STATE_TRACKING;
+		return wallState;
+	}
+
+	// Wall is gone, creep on along the heading for a while,
+	// the wall may only have a gap.
+	wallErrorIntegral = 0.0;
+	if( now - wallLostTime < WALL_LOST_TIMEOUT )
+	{
+		moveMecanumReact( WALL_SPEED_LOST, 0, (int)rotate );
+		wallState = WALL_STATE_SEARCHING;
+	}
+	else
+	{
+		if( wallState != WALL_STATE_LOST )
+			writeDebugStreamLine("wallFollowerStep wall lost");
+		moveStopReact();
+		wallState = WALL_STATE_LOST;
+	}
+
+	wallPoseLastX = odomX;
+	wallPoseLastY = odomY;
+	wallTimeLast 	= now;
+	return wallState;
+} // end wallFollowerStep
+
+//==========================================================
+//	wallErrorRMS
+//	Root mean square distance error from WALL_DISTANCE,
+//	inches
+//==========================================================
+float wallErrorRMS()
+{
+	if( wallErrorSamples == 0 )
+		return 0.0;
+
+	return sqrt( wallErrorSumSquares / wallErrorSamples );
+} // end wallErrorRMS
+
+//==========================================================
+//	wallSpeed
+//	Average speed along the wall while tracking, inches per
+//	second
+//==========================================================
+float wallSpeed()
+{
+	if( wallTrackTime == 0 )
+		return 0.0;
+
+	return wallDistance * 1000.0 / wallTrackTime;
+} // end wallSpeed
+
+//==========================================================
+//	wallFollowerReport
+//	Write the run metrics to the debug stream
+//==========================================================
+void wallFollowerReport()
+{
+	writeDebugStreamLine("wall: %f in in %d ms, %f in/s, %d corners",
+												wallDistance, wallTrackTime, wallSpeed(), wallCornerCount);
+	writeDebugStreamLine("wall error rms: %f in max: %f in heading max: %f deg",
+												wallErrorRMS(), wallErrorMax, wallHeadingErrorMax);
+} // end wallFollowerReport